@@ -0,0 +1,238 @@
+/**
+ * @file alpha.c
+ * @brief Alpha-nearness candidates from the minimum 1-tree, on distances optionally penalized by subgradient ascent.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+/* ************************************************************************** */
+
+/* minimum 1-tree on penalized distances */
+typedef struct onetree {
+  uint special;   /* special city, out of the spanning tree, joined by its two shortest edges */
+  uint *dad;      /* parent of each city in the spanning tree (n for the root and the special city) */
+  double *dadc;   /* penalized distance to the parent */
+  uint *order;    /* cities of the spanning tree, parents first */
+  uint *deg;      /* degree of each city in the 1-tree */
+  double second;  /* penalized distance of the second edge of the special city */
+  double len;     /* penalized length of the 1-tree */
+} onetree;
+
+static inline double alpha_cost(TSP *tsp, double *pi, uint i, uint j) { return tsp_dist(tsp, i, j) + pi[i] + pi[j]; }
+
+/* ************************************************************************** */
+
+/* Prim in O(n²) on all cities but the special one, then the two shortest edges of the special city */
+static void alpha_tree(TSP *tsp, double *pi, onetree *t, double *key, bool *in) {
+  uint n = tsp->size, s = t->special;
+  for (uint i = 0; i < n; i++) {
+    key[i] = DBL_MAX;
+    in[i] = (i == s);
+    t->dad[i] = n;
+    t->deg[i] = 0;
+  }
+  t->len = 0.0;
+  uint city = (s == 0) ? 1 : 0;
+  key[city] = 0.0;
+  for (uint k = 0; k + 1 < n; k++) {
+    in[city] = true;
+    t->order[k] = city;
+    if (t->dad[city] < n) {
+      t->dadc[city] = key[city];
+      t->len += key[city];
+      t->deg[city]++;
+      t->deg[t->dad[city]]++;
+    }
+    uint next = n;
+    for (uint j = 0; j < n; j++) {
+      if (in[j]) continue;
+      double c = alpha_cost(tsp, pi, city, j);
+      if (c < key[j]) {
+        key[j] = c;
+        t->dad[j] = city;
+      }
+      if (next == n || key[j] < key[next]) next = j;
+    }
+    city = next;
+  }
+  uint f1 = n, f2 = n; /* ends of both special edges */
+  for (uint j = 0; j < n; j++) {
+    if (j == s) continue;
+    double c = alpha_cost(tsp, pi, s, j);
+    if (f1 == n || c < alpha_cost(tsp, pi, s, f1)) {
+      f2 = f1;
+      f1 = j;
+    } else if (f2 == n || c < alpha_cost(tsp, pi, s, f2)) f2 = j;
+  }
+  t->second = alpha_cost(tsp, pi, s, f2);
+  t->len += alpha_cost(tsp, pi, s, f1) + t->second;
+  t->deg[s] = 2;
+  t->deg[f1]++;
+  t->deg[f2]++;
+}
+
+/* ************************************************************************** */
+
+/* subgradient ascent of the Held-Karp bound: penalties of cities of degree above 2 increase, below 2 decrease */
+static void alpha_ascent(TSP *tsp, double *pi, uint iterations, onetree *t, double *key, bool *in) {
+  uint n = tsp->size;
+  double *best = calloc(n, sizeof(double));
+  int *prev = calloc(n, sizeof(int));
+  assert(best && prev);
+  alpha_tree(tsp, pi, t, key, in);
+  double bestw = t->len;
+  double step = 0.1 * t->len / n; /* 10% of the mean edge, down to 0.1% at the end */
+  double decay = pow(0.01, 1.0 / iterations);
+  for (uint it = 0; it < iterations; it++) {
+    bool tour = true;
+    for (uint i = 0; i < n; i++) {
+      int d = (int)t->deg[i] - 2;
+      if (d != 0) tour = false;
+      pi[i] += step * (0.7 * d + 0.3 * prev[i]);
+      prev[i] = d;
+    }
+    if (tour) break; /* the 1-tree is a tour, hence optimal */
+    alpha_tree(tsp, pi, t, key, in);
+    double w = t->len;
+    for (uint i = 0; i < n; i++) w -= 2.0 * pi[i];
+    if (w > bestw) {
+      bestw = w;
+      for (uint i = 0; i < n; i++) best[i] = pi[i];
+    }
+    step *= decay;
+  }
+  for (uint i = 0; i < n; i++) pi[i] = best[i];
+  free(prev);
+  free(best);
+}
+
+/* ************************************************************************** */
+
+/* insert a city in a list of the k smallest alphas (ties: shortest first) */
+static void alpha_insert(uint *nbr, double *a, uint *len, uint k, uint city, double alpha, double c, double *cost) {
+  if (*len == k && (alpha > a[k - 1] || (alpha == a[k - 1] && c >= cost[k - 1]))) return;
+  uint pos = (*len < k) ? (*len)++ : k - 1;
+  while (pos > 0 && (a[pos - 1] > alpha || (a[pos - 1] == alpha && cost[pos - 1] > c))) {
+    nbr[pos] = nbr[pos - 1];
+    a[pos] = a[pos - 1];
+    cost[pos] = cost[pos - 1];
+    pos--;
+  }
+  nbr[pos] = city;
+  a[pos] = alpha;
+  cost[pos] = c;
+}
+
+/* ************************************************************************** */
+
+cand *cand_alpha(TSP *tsp, uint k, uint ascent) {
+  assert(tsp);
+  assert(tsp_symmetric(tsp));
+  uint n = tsp->size;
+  if (k > n - 1) k = n - 1;
+  double *pi = calloc(n, sizeof(double));
+  double *key = malloc(n * sizeof(double));
+  bool *in = malloc(n * sizeof(bool));
+  onetree t;
+  t.special = tsp->first;
+  t.dad = malloc(n * sizeof(uint));
+  t.dadc = malloc(n * sizeof(double));
+  t.order = malloc(n * sizeof(uint));
+  t.deg = malloc(n * sizeof(uint));
+  assert(pi && key && in && t.dad && t.dadc && t.order && t.deg);
+  if (ascent > 0) alpha_ascent(tsp, pi, ascent, &t, key, in);
+  alpha_tree(tsp, pi, &t, key, in);
+
+  cand *c = malloc(sizeof(cand));
+  assert(c);
+  c->size = n;
+  c->start = huge_map((n + 1) * sizeof(uint));
+  c->adj = huge_map((size_t)n * k * sizeof(uint));
+  for (uint i = 0; i <= n; i++) c->start[i] = i * k;
+
+  /* alpha(i,j) = c(i,j) - beta(i,j), with beta(i,j) the longest edge on the tree path from i to j, computed for
+   * all j at once in topological order: beta(i,j) = max(beta(i,dad j), c(j,dad j)) unless j is above i */
+  uint s = t.special;
+#pragma omp parallel
+  {
+    double *beta = malloc(n * sizeof(double));
+    uint *mark = malloc(n * sizeof(uint));
+    double *a = malloc(k * sizeof(double));
+    double *cost = malloc(k * sizeof(double));
+    assert(beta && mark && a && cost);
+    for (uint j = 0; j < n; j++) mark[j] = n;
+#pragma omp for schedule(dynamic, 16)
+    for (uint i = 0; i < n; i++) {
+      uint *nbr = &c->adj[(size_t)i * k];
+      uint len = 0;
+      if (i == s) { /* special edges: the second one is the longest edge that a forced edge replaces */
+        for (uint j = 0; j < n; j++) {
+          if (j == s) continue;
+          double cij = alpha_cost(tsp, pi, s, j);
+          alpha_insert(nbr, a, &len, k, j, (cij > t.second) ? cij - t.second : 0.0, cij, cost);
+        }
+        continue;
+      }
+      beta[i] = -DBL_MAX;
+      for (uint j = i; t.dad[j] < n; j = t.dad[j]) {
+        beta[t.dad[j]] = (beta[j] > t.dadc[j]) ? beta[j] : t.dadc[j];
+        mark[t.dad[j]] = i;
+      }
+      for (uint l = 0; l + 1 < n; l++) {
+        uint j = t.order[l];
+        if (j == i) continue;
+        if (mark[j] != i) beta[j] = (beta[t.dad[j]] > t.dadc[j]) ? beta[t.dad[j]] : t.dadc[j];
+        double cij = alpha_cost(tsp, pi, i, j);
+        alpha_insert(nbr, a, &len, k, j, cij - beta[j], cij, cost);
+      }
+      double cis = alpha_cost(tsp, pi, i, s);
+      alpha_insert(nbr, a, &len, k, s, (cis > t.second) ? cis - t.second : 0.0, cis, cost);
+    }
+    free(cost);
+    free(a);
+    free(mark);
+    free(beta);
+  }
+
+  /* the k best cities by alpha, sorted by distance as all candidate lists */
+  for (uint i = 0; i < n; i++) {
+    uint *nbr = &c->adj[(size_t)i * k];
+    for (uint l = 1; l < k; l++) {
+      uint city = nbr[l], d = tsp_dist(tsp, i, city);
+      uint m = l;
+      while (m > 0 && tsp_dist(tsp, i, nbr[m - 1]) > d) {
+        nbr[m] = nbr[m - 1];
+        m--;
+      }
+      nbr[m] = city;
+    }
+  }
+
+  free(t.deg);
+  free(t.order);
+  free(t.dadc);
+  free(t.dad);
+  free(in);
+  free(key);
+  free(pi);
+  return c;
+}
+
+/* ************************************************************************** */
+
+void tsp_set_cand(TSP *tsp, cand *c) {
+  assert(tsp);
+  assert(!c || c->size == tsp->size);
+  tsp->cand = c;
+}
+
+/* ************************************************************************** */
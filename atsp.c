@@ -0,0 +1,180 @@
+/**
+ * @file atsp.c
+ * @brief Reversal-free local search for asymmetric instances: or-opt and or-3opt moves.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define OROPT_MAXSEG 3 /* max nb of cities of the segments moved by or-opt */
+
+/* ************************************************************************** */
+
+/* tour as a cycle with city positions, and its active cities */
+typedef struct atour {
+  TSP *tsp;
+  uint n;
+  uint *cycle; /* cities in tour order */
+  uint *pos;   /* position of each city in cycle */
+  uint *buf;   /* buffer of n cities */
+  uint *fifo;  /* circular queue of active cities */
+  bool *active;
+  uint head, len;
+} atour;
+
+static inline uint at_succ(atour *t, uint city) { return t->cycle[(t->pos[city] + 1) % t->n]; }
+static inline uint at_pred(atour *t, uint city) { return t->cycle[(t->pos[city] + t->n - 1) % t->n]; }
+
+/* nb of steps from city a to city x along the tour */
+static inline uint at_off(atour *t, uint a, uint x) { return (t->pos[x] + t->n - t->pos[a]) % t->n; }
+
+static void at_push(atour *t, uint city) {
+  if (t->active[city]) return;
+  t->active[city] = true;
+  t->fifo[(t->head + t->len++) % t->n] = city;
+}
+
+/* ************************************************************************** */
+
+/* swap two adjacent blocks of the cycle, of l1 and l2 cities from position s, keeping their orientation */
+static void at_swap(atour *t, uint s, uint l1, uint l2) {
+  uint n = t->n;
+  for (uint k = 0; k < l1 + l2; k++) t->buf[k] = t->cycle[(s + k) % n];
+  for (uint k = 0; k < l2; k++) t->cycle[(s + k) % n] = t->buf[l1 + k];
+  for (uint k = 0; k < l1; k++) t->cycle[(s + l2 + k) % n] = t->buf[k];
+  for (uint k = 0; k < l1 + l2; k++) t->pos[t->cycle[(s + k) % n]] = (s + k) % n;
+}
+
+/* ************************************************************************** */
+
+/* or-3opt move (segment exchange): the tour a X b' ... c Z, with X = a'..b and Y = b'..c, becomes a Y X Z, that
+ * is edges (a,a'), (b,b'), (c,c') replaced by (a,b'), (c,a'), (b,c'); the largest of the 3 blocks is not moved */
+static void at_move(atour *t, uint a, uint b, uint c) {
+  uint n = t->n;
+  uint lx = at_off(t, a, b), ly = at_off(t, a, c) - lx, lz = n - lx - ly;
+  uint ap = at_succ(t, a), bp = at_succ(t, b), cp = at_succ(t, c);
+  uint s = (t->pos[a] + 1) % n;
+  if (lz >= lx && lz >= ly) at_swap(t, s, lx, ly); /* Y X Z */
+  else if (lx >= ly) at_swap(t, (s + lx) % n, ly, lz); /* X Z Y */
+  else at_swap(t, (s + lx + ly) % n, lz, lx); /* Y X Z, across the end of the cycle */
+  uint touched[6] = {a, ap, b, bp, c, cp};
+  for (uint k = 0; k < 6; k++) at_push(t, touched[k]);
+}
+
+/* ************************************************************************** */
+
+/* gain of the or-3opt move at_move(a, b, c) */
+static inline long long at_gain(TSP *tsp, uint a, uint ap, uint b, uint bp, uint c, uint cp) {
+  return (long long)tsp_dist(tsp, a, ap) + tsp_dist(tsp, b, bp) + tsp_dist(tsp, c, cp) - tsp_dist(tsp, a, bp) -
+         tsp_dist(tsp, c, ap) - tsp_dist(tsp, b, cp);
+}
+
+/* ************************************************************************** */
+
+/* first improving move around city x: or-opt of the segments starting or ending at x, then or-3opt from x */
+static bool at_improve(atour *t, cand *out, cand *in, uint x) {
+  TSP *tsp = t->tsp;
+  uint n = t->n;
+
+  /* or-opt: segment X = x..e moved between c and c', with c in the in-candidates of x, or c' in the
+   * out-candidates of e, then segment X = s..x with the same candidates of its own ends */
+  for (uint len = 1; len <= OROPT_MAXSEG && len + 2 < n; len++)
+    for (uint side = 0; side < 2 - (len == 1); side++) {
+      uint a = (side == 0) ? at_pred(t, x) : t->cycle[(t->pos[x] + 2 * n - len) % n];
+      uint ap = at_succ(t, a);
+      uint b = t->cycle[(t->pos[a] + len) % n], bp = at_succ(t, b);
+      for (uint k = in->start[ap]; k < in->start[ap + 1]; k++) {
+        uint c = in->adj[k];
+        if (at_off(t, a, c) <= len) continue; /* c in a X */
+        uint cp = at_succ(t, c);
+        long long gain = at_gain(tsp, a, ap, b, bp, c, cp);
+        if (gain <= 0) continue;
+        at_move(t, a, b, c);
+        return true;
+      }
+      for (uint k = out->start[b]; k < out->start[b + 1]; k++) {
+        uint cp = out->adj[k];
+        uint c = at_pred(t, cp);
+        if (at_off(t, a, c) <= len) continue;
+        long long gain = at_gain(tsp, a, ap, b, bp, c, cp);
+        if (gain <= 0) continue;
+        at_move(t, a, b, c);
+        return true;
+      }
+    }
+
+  /* or-3opt: new edge (x,b') with b' in the out-candidates of x, then new edge (c,a') with c in the
+   * in-candidates of a', and c in Y = b'..c */
+  uint a = x, ap = at_succ(t, a);
+  long long daa = tsp_dist(tsp, a, ap);
+  for (uint k = out->start[a]; k < out->start[a + 1]; k++) {
+    uint bp = out->adj[k];
+    long long g1 = daa - tsp_dist(tsp, a, bp);
+    if (g1 <= 0) break; /* sorted lists: no positive partial gain beyond */
+    uint b = at_pred(t, bp);
+    if (bp == ap || b == a) continue;
+    uint ob = at_off(t, a, b);
+    long long g2 = g1 + tsp_dist(tsp, b, bp);
+    for (uint l = in->start[ap]; l < in->start[ap + 1]; l++) {
+      uint c = in->adj[l];
+      long long dca = tsp_dist(tsp, c, ap);
+      if (dca >= g2) break;
+      if (c == a || at_off(t, a, c) <= ob) continue; /* c in a X */
+      uint cp = at_succ(t, c);
+      long long gain = g2 - dca + tsp_dist(tsp, c, cp) - tsp_dist(tsp, b, cp);
+      if (gain <= 0) continue;
+      at_move(t, a, b, c);
+      return true;
+    }
+  }
+  return false;
+}
+
+/* ************************************************************************** */
+
+void tsp_or3opt(TSP *tsp, path *p, cand *out, cand *in) {
+  assert(tsp && p);
+  assert(p->curlen == tsp->size + 1);
+  uint n = tsp->size;
+  if (!out) out = tsp->cand;
+  cand *ownout = out ? NULL : cand_knn(tsp, 8);
+  cand *ownin = in ? NULL : cand_knn_in(tsp, 8);
+  if (!out) out = ownout;
+  if (!in) in = ownin;
+
+  atour t = {tsp, n, p->array, NULL, NULL, NULL, NULL, 0, 0};
+  t.pos = malloc(n * sizeof(uint));
+  t.buf = malloc(n * sizeof(uint));
+  t.fifo = malloc(n * sizeof(uint));
+  t.active = calloc(n, sizeof(bool));
+  assert(t.pos && t.buf && t.fifo && t.active);
+  for (uint i = 0; i < n; i++) t.pos[p->array[i]] = i;
+  for (uint i = 0; i < n && n >= 4; i++) at_push(&t, p->array[i]);
+
+  while (t.len > 0) {
+    uint x = t.fifo[t.head];
+    t.head = (t.head + 1) % n;
+    t.len--;
+    t.active[x] = false;
+    if (at_improve(&t, out, in, x)) at_push(&t, x);
+  }
+
+  path_rotate(tsp, p);
+  if (tsp->elite) elite_insert(tsp->elite, p);
+  if (tsp->profile) profile_record(tsp->profile, p->dist);
+  free(t.active);
+  free(t.fifo);
+  free(t.buf);
+  free(t.pos);
+  cand_free(ownout);
+  cand_free(ownin);
+}
+
+/* ************************************************************************** */
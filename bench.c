@@ -0,0 +1,223 @@
+/**
+ * @file bench.c
+ * @brief Anytime benchmark: incumbent over time of an engine over many seeds, time to target and gap over time.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tsp.h"
+
+#define POINTMAX 1000 /* max coordinate of random instances */
+#define GAPSTEPS 50   /* nb of times of the gap over time, on a log scale */
+
+/* ************************************************************************** */
+
+void usage(int argc, char *argv[]) {
+  printf("Usage: %s [options] <engine>\n", argv[0]);
+  printf("Run an engine once per seed, and write its incumbents over time as CSV files.\n");
+  printf("Engines:\n");
+  printf(" exact: exact search (tsp_solve)\n");
+  printf(" lns: random tour, local search, then large neighbourhood search\n");
+  printf(" gls: random tour, 2-opt, then guided local search [symmetric instances]\n");
+  printf("Options:\n");
+  printf(" -l filename: load distance matrix\n");
+  printf(" -p filename: load city coordinates\n");
+  printf(" -r size: random city coordinates, a new instance per seed\n");
+  printf(" -s seeds: nb of runs, with seeds 0 to seeds-1 [default: 10]\n");
+  printf(" -i iterations: nb of iterations of lns and gls [default: 1000]\n");
+  printf(" -b dist: reference distance of gaps, optimal or best known [default: best final tour on the instance]\n");
+  printf(" -t gap: target gap in percent, for the time to target [default: 1]\n");
+  printf(" -o prefix: write prefix-runs.csv, prefix-ttt.csv and prefix-gap.csv [default: bench]\n");
+  printf(" -h: print usage\n");
+  exit(EXIT_FAILURE);
+}
+
+/* ************************************************************************** */
+
+/* run an engine on an instance, recording its incumbents in a profile from its start tour */
+void bench_run(TSP *tsp, profile *pr, char *engine, uint seed, uint iterations) {
+  if (strcmp(engine, "exact") == 0) {
+    path *sol = tsp_solve(tsp, NULL);
+    path_free(sol);
+    return;
+  }
+  path *tour = tsp_random(tsp, seed);
+  profile_record(pr, path_dist(tour));
+  if (tsp_symmetric(tsp)) tsp_2opt(tsp, tour, NULL);
+  else tsp_or3opt(tsp, tour, NULL, NULL);
+  if (strcmp(engine, "lns") == 0) tsp_lns(tsp, tour, NULL, 8, iterations, seed);
+  else tsp_gls(tsp, tour, NULL, iterations);
+  path_free(tour);
+}
+
+/* ************************************************************************** */
+
+int cmp_double(const void *x, const void *y) {
+  double a = *(const double *)x, b = *(const double *)y;
+  return (a > b) - (a < b);
+}
+
+/* ************************************************************************** */
+
+FILE *csv_open(char *prefix, char *suffix) {
+  char *filename = malloc(strlen(prefix) + strlen(suffix) + 1);
+  assert(filename);
+  strcpy(filename, prefix);
+  strcat(filename, suffix);
+  FILE *file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error: cannot write \"%s\"\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  free(filename);
+  return file;
+}
+
+/* ************************************************************************** */
+
+int main(int argc, char *argv[]) {
+  char *filename = NULL, *pointsfile = NULL;
+  uint random = 0, seeds = 10, iterations = 1000, reference = 0;
+  double target = 1.0;
+  char *prefix = "bench";
+  int c;
+  while ((c = getopt(argc, argv, "hl:p:r:s:i:b:t:o:")) != -1) {
+    if (c == 'l') filename = optarg;
+    if (c == 'p') pointsfile = optarg;
+    if (c == 'r') random = atoi(optarg);
+    if (c == 's') seeds = atoi(optarg);
+    if (c == 'i') iterations = atoi(optarg);
+    if (c == 'b') reference = atoi(optarg);
+    if (c == 't') target = atof(optarg);
+    if (c == 'o') prefix = optarg;
+    if (c == 'h') usage(argc, argv);
+  }
+  if (optind != argc - 1 || (!filename + !pointsfile + !random) != 2 || seeds < 1) usage(argc, argv);
+  char *engine = argv[optind];
+  if (strcmp(engine, "exact") != 0 && strcmp(engine, "lns") != 0 && strcmp(engine, "gls") != 0) usage(argc, argv);
+  if (random > 0 && random < 3) usage(argc, argv);
+
+  /* one run per seed, on the same instance unless random */
+  uint size = 0;
+  uint *distmat = filename ? distmat_load(filename, &size) : NULL;
+  double *points = pointsfile ? points_load(pointsfile, &size) : NULL;
+  profile **runs = malloc(seeds * sizeof(profile *));
+  double *ends = malloc(seeds * sizeof(double));
+  uint *refs = malloc(seeds * sizeof(uint));
+  assert(runs && ends && refs);
+  for (uint s = 0; s < seeds; s++) {
+    if (random) {
+      size = random;
+      points = points_random(size, s, POINTMAX);
+    }
+    TSP *tsp = distmat ? tsp_new(size, 0, distmat, OPTIMIZE) : tsp_new_points(size, 0, points, OPTIMIZE);
+    if (strcmp(engine, "gls") == 0 && !tsp_symmetric(tsp)) usage(argc, argv);
+    runs[s] = profile_new();
+    tsp_set_profile(tsp, runs[s]);
+    bench_run(tsp, runs[s], engine, s, iterations);
+    ends[s] = profile_elapsed(runs[s]);
+    assert(profile_len(runs[s]) > 0);
+    profile_point(runs[s], profile_len(runs[s]) - 1, NULL, &refs[s]);
+    tsp_free(tsp);
+    if (random) {
+      free(points);
+      points = NULL;
+    }
+  }
+
+  /* gaps to the given reference, else to the best final tour on the same instance */
+  uint best = UINT_MAX;
+  for (uint s = 0; s < seeds; s++) best = (refs[s] < best) ? refs[s] : best;
+  for (uint s = 0; s < seeds; s++)
+    if (reference > 0) refs[s] = reference;
+    else if (!random) refs[s] = best;
+
+  /* incumbents of all runs */
+  FILE *file = csv_open(prefix, "-runs.csv");
+  fprintf(file, "seed,time,dist,gap\n");
+  for (uint s = 0; s < seeds; s++)
+    for (uint i = 0; i < profile_len(runs[s]); i++) {
+      double t;
+      uint d;
+      profile_point(runs[s], i, &t, &d);
+      fprintf(file, "%u,%.6f,%u,%.4f\n", s, t, d, 100.0 * ((double)d - refs[s]) / refs[s]);
+    }
+  fclose(file);
+
+  /* empirical distribution of the time to target, with probabilities (i+1/2)/seeds of the sorted times */
+  double *ttt = malloc(seeds * sizeof(double));
+  assert(ttt);
+  uint reached = 0;
+  for (uint s = 0; s < seeds; s++) {
+    double t = profile_time_to(runs[s], (uint)floor(refs[s] * (1.0 + target / 100.0)));
+    if (t >= 0.0) ttt[reached++] = t;
+  }
+  qsort(ttt, reached, sizeof(double), cmp_double);
+  file = csv_open(prefix, "-ttt.csv");
+  fprintf(file, "time,probability\n");
+  for (uint i = 0; i < reached; i++) fprintf(file, "%.6f,%.4f\n", ttt[i], (i + 0.5) / seeds);
+  fclose(file);
+
+  /* mean gap over time, on a log scale from the first incumbent to the end of the longest run, among the runs
+   * with an incumbent at that time */
+  double tmin = 0.0, tmax = 0.0;
+  for (uint s = 0; s < seeds; s++) {
+    double t;
+    profile_point(runs[s], 0, &t, NULL);
+    if (s == 0 || t < tmin) tmin = t;
+    if (ends[s] > tmax) tmax = ends[s];
+  }
+  if (tmin < 1e-6) tmin = 1e-6;
+  if (tmax < tmin) tmax = tmin;
+  file = csv_open(prefix, "-gap.csv");
+  fprintf(file, "time,gap,runs\n");
+  for (uint k = 0; k <= GAPSTEPS; k++) {
+    double t = tmin * pow(tmax / tmin, (double)k / GAPSTEPS);
+    double sum = 0.0;
+    uint nruns = 0;
+    for (uint s = 0; s < seeds; s++) {
+      uint d = profile_at(runs[s], t);
+      if (d == UINT_MAX) continue;
+      sum += 100.0 * ((double)d - refs[s]) / refs[s];
+      nruns++;
+    }
+    if (nruns > 0) fprintf(file, "%.6f,%.4f,%u\n", t, sum / nruns, nruns);
+  }
+  fclose(file);
+
+  /* summary */
+  double total = 0.0, gap = 0.0;
+  for (uint s = 0; s < seeds; s++) {
+    uint d;
+    profile_point(runs[s], profile_len(runs[s]) - 1, NULL, &d);
+    total += ends[s];
+    gap += 100.0 * ((double)d - refs[s]) / refs[s];
+  }
+  printf("Engine %s: %u runs in %.3f s on average, final gap %.3f%% on average.\n", engine, seeds, total / seeds,
+         gap / seeds);
+  if (reached > 0)
+    printf("Target gap %.2f%% reached by %u runs, in %.3f s at median.\n", target, reached, ttt[reached / 2]);
+  else printf("Target gap %.2f%% never reached.\n", target);
+  printf("Results written in %s-runs.csv, %s-ttt.csv and %s-gap.csv.\n", prefix, prefix, prefix);
+
+  free(ttt);
+  for (uint s = 0; s < seeds; s++) profile_free(runs[s]);
+  free(refs);
+  free(ends);
+  free(runs);
+  free(points);
+  free(distmat);
+  return EXIT_SUCCESS;
+}
+
+/* ************************************************************************** */
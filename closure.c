@@ -0,0 +1,205 @@
+/**
+ * @file closure.c
+ * @brief Shortest path closure of distance matrices with missing or non-shortest arcs.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define CLOSURE_BLOCK 64  /* block size of Floyd-Warshall, so that 3 blocks fit in L1/L2 caches */
+#define CLOSURE_SPARSE 8  /* Dijkstra if less than 1/CLOSURE_SPARSE of the arcs are given */
+
+/* ************************************************************************** */
+/*                              FLOYD-WARSHALL                                */
+/* ************************************************************************** */
+
+/* relax block (ib,jb) through the intermediate cities of block kb */
+static void closure_block(uint n, uint *dist, uint *next, uint ib, uint jb, uint kb) {
+  uint iend = (ib + CLOSURE_BLOCK < n) ? ib + CLOSURE_BLOCK : n;
+  uint jend = (jb + CLOSURE_BLOCK < n) ? jb + CLOSURE_BLOCK : n;
+  uint kend = (kb + CLOSURE_BLOCK < n) ? kb + CLOSURE_BLOCK : n;
+  for (uint k = kb; k < kend; k++)
+    for (uint i = ib; i < iend; i++) {
+      unsigned long long dik = dist[(size_t)i * n + k];
+      if (dik == DIST_INF) continue;
+      uint *di = &dist[(size_t)i * n];
+      uint *ni = &next[(size_t)i * n];
+      uint *dk = &dist[(size_t)k * n];
+      uint nik = ni[k];
+      /* branch-free selects, vectorized by the compiler */
+      for (uint j = jb; j < jend; j++) {
+        unsigned long long alt = dik + dk[j];
+        bool better = alt < di[j];
+        di[j] = better ? (uint)alt : di[j];
+        ni[j] = better ? nik : ni[j];
+      }
+    }
+}
+
+/* ************************************************************************** */
+
+/* blocked Floyd-Warshall: diagonal block, then its row and column, then all other blocks in parallel */
+static void closure_floyd(uint n, uint *dist, uint *next) {
+  int nb = (n + CLOSURE_BLOCK - 1) / CLOSURE_BLOCK;
+  for (int b = 0; b < nb; b++) {
+    uint kb = b * CLOSURE_BLOCK;
+    closure_block(n, dist, next, kb, kb, kb);
+#pragma omp parallel for schedule(static)
+    for (int x = 0; x < nb; x++) {
+      if (x == b) continue;
+      closure_block(n, dist, next, kb, x * CLOSURE_BLOCK, kb);
+      closure_block(n, dist, next, x * CLOSURE_BLOCK, kb, kb);
+    }
+#pragma omp parallel for schedule(static) collapse(2)
+    for (int x = 0; x < nb; x++)
+      for (int y = 0; y < nb; y++)
+        if (x != b && y != b) closure_block(n, dist, next, x * CLOSURE_BLOCK, y * CLOSURE_BLOCK, kb);
+  }
+}
+
+/* ************************************************************************** */
+/*                                 DIJKSTRA                                   */
+/* ************************************************************************** */
+
+typedef struct heapitem {
+  unsigned long long dist;
+  uint city;
+} heapitem;
+
+static void closure_push(heapitem *heap, uint *len, unsigned long long dist, uint city) {
+  uint i = (*len)++;
+  while (i > 0 && heap[(i - 1) / 2].dist > dist) {
+    heap[i] = heap[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap[i] = (heapitem){dist, city};
+}
+
+static heapitem closure_pop(heapitem *heap, uint *len) {
+  heapitem top = heap[0], last = heap[--(*len)];
+  uint i = 0;
+  while (2 * i + 1 < *len) {
+    uint c = 2 * i + 1;
+    if (c + 1 < *len && heap[c + 1].dist < heap[c].dist) c++;
+    if (heap[c].dist >= last.dist) break;
+    heap[i] = heap[c];
+    i = c;
+  }
+  heap[i] = last;
+  return top;
+}
+
+/* ************************************************************************** */
+
+/* one Dijkstra per source in parallel, on the given arcs only */
+static void closure_dijkstra(uint n, uint *distmat, uint *dist, uint *next, size_t narcs) {
+  /* arcs as adjacency lists */
+  uint *start = calloc(n + 1, sizeof(uint));
+  uint *adj = malloc(narcs * sizeof(uint));
+  assert(start && adj);
+  for (uint i = 0; i < n; i++) {
+    start[i + 1] = start[i];
+    for (uint j = 0; j < n; j++)
+      if (i != j && distmat[(size_t)i * n + j] != DIST_INF) adj[start[i + 1]++] = j;
+  }
+
+#pragma omp parallel
+  {
+    heapitem *heap = malloc((narcs + 1) * sizeof(heapitem));
+    bool *done = malloc(n * sizeof(bool));
+    assert(heap && done);
+#pragma omp for schedule(dynamic)
+    for (uint s = 0; s < n; s++) {
+      uint *ds = &dist[(size_t)s * n], *ns = &next[(size_t)s * n];
+      for (uint v = 0; v < n; v++) {
+        ds[v] = (v == s) ? 0 : DIST_INF;
+        ns[v] = v;
+        done[v] = false;
+      }
+      uint len = 0;
+      closure_push(heap, &len, 0, s);
+      while (len > 0) {
+        heapitem top = closure_pop(heap, &len);
+        uint u = top.city;
+        if (done[u]) continue;
+        done[u] = true;
+        for (uint a = start[u]; a < start[u + 1]; a++) {
+          uint v = adj[a];
+          unsigned long long alt = top.dist + distmat[(size_t)u * n + v];
+          if (done[v] || alt >= ds[v]) continue;
+          ds[v] = alt;
+          ns[v] = (u == s) ? v : ns[u]; /* first hop from s */
+          closure_push(heap, &len, alt, v);
+        }
+      }
+    }
+    free(done);
+    free(heap);
+  }
+
+  free(adj);
+  free(start);
+}
+
+/* ************************************************************************** */
+/*                                 CLOSURE                                    */
+/* ************************************************************************** */
+
+uint *distmat_closure(uint size, uint *distmat, uint *next) {
+  assert(size >= 2 && distmat);
+  uint n = size;
+  uint *dist = huge_alloc((size_t)n * n * sizeof(uint), false);
+  uint *hops = next ? next : huge_alloc((size_t)n * n * sizeof(uint), false);
+  assert(dist && hops);
+  size_t narcs = 0;
+  for (size_t i = 0; i < (size_t)n * n; i++)
+    if (i % (n + 1) != 0 && distmat[i] != DIST_INF) narcs++;
+
+  if (narcs * CLOSURE_SPARSE < (size_t)n * (n - 1)) {
+    closure_dijkstra(n, distmat, dist, hops, narcs);
+  } else {
+    for (uint i = 0; i < n; i++)
+      for (uint j = 0; j < n; j++) {
+        dist[(size_t)i * n + j] = (i == j) ? 0 : distmat[(size_t)i * n + j];
+        hops[(size_t)i * n + j] = j;
+      }
+    closure_floyd(n, dist, hops);
+  }
+
+  for (size_t i = 0; i < (size_t)n * n; i++)
+    if (dist[i] == DIST_INF) {
+      fprintf(stderr, "Error: no path from city %zu to city %zu in the distance matrix\n", i / n, i % n);
+      exit(EXIT_FAILURE);
+    }
+  if (!next) free(hops);
+  return dist;
+}
+
+/* ************************************************************************** */
+
+path *path_expand(path *p, uint size, uint *next) {
+  assert(p && next);
+  assert(p->curlen >= 1);
+  uint len = 1;
+  for (uint i = 0; i + 1 < p->curlen; i++)
+    for (uint c = p->array[i]; c != p->array[i + 1]; c = next[(size_t)c * size + p->array[i + 1]]) len++;
+  path *q = path_new(len, p->dist);
+  q->array[q->curlen++] = p->array[0];
+  for (uint i = 0; i + 1 < p->curlen; i++) {
+    uint to = p->array[i + 1];
+    for (uint c = p->array[i]; c != to;) {
+      c = next[(size_t)c * size + to];
+      q->array[q->curlen++] = c;
+    }
+  }
+  return q;
+}
+
+/* ************************************************************************** */
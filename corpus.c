@@ -0,0 +1,199 @@
+/**
+ * @file corpus.c
+ * @brief Corpus runner: run an engine on all instances of a manifest, and check gaps to optimum and node counts.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tsp.h"
+
+#define RANDOMMAX 100  /* max distance of random matrices */
+#define POINTMAX 1000  /* max coordinate of random points */
+#define MANIFEST_LINE 1024
+#define CALIB_SIZE 9       /* size of the calibration search */
+#define CALIB_SECONDS 0.2  /* min duration of the calibration */
+#define ESTIMATE_MARGIN 3.0 /* factor widening the estimated interval of nodes, whose probes prune with a fixed bound */
+
+/* ************************************************************************** */
+
+void usage(int argc, char *argv[]) {
+  printf("Usage: %s [options] <manifest>\n", argv[0]);
+  printf("Run an engine on all instances of a corpus manifest, with lines \"name source optimum nodes [time]\":\n");
+  printf(" source: TSPLIB file (relative to the manifest), random:size:seed (distance matrix, distances 1 to %u)\n",
+         RANDOMMAX);
+  printf("   or points:size:seed (city coordinates in [0,%u[)\n", POINTMAX);
+  printf(" optimum: optimal tour distance\n");
+  printf(" nodes: baseline nb of nodes of the exact search (0 for none)\n");
+  printf(" time: baseline normalized time of the exact search (0 or none for none), in millions of nodes of a\n");
+  printf("   calibration search without pruning on this machine\n");
+  printf("Options:\n");
+  printf(" -e engine: exact, parallel, local (nearest neighbour and local search) or lns [default: exact]\n");
+  printf(" -g gap: max gap to optimum of heuristics, in percent [default: 10]\n");
+  printf(" -s slack: max increase of nodes over the baseline, in percent [default: 0]\n");
+  printf(" -t tolerance: increase of normalized time over the baseline for a warning, in percent [default: 50]\n");
+  printf(" -x probes: estimate the exact search beforehand, and check that its 95%% interval of nodes, widened\n");
+  printf("   by a factor %g, contains the real nb of nodes [default: 0, no estimate]\n", ESTIMATE_MARGIN);
+  printf(" -w: print the manifest with the nodes and times measured as new baselines, instead of checking them\n");
+  printf(" -h: print usage\n");
+  exit(EXIT_FAILURE);
+}
+
+/* ************************************************************************** */
+
+/* load the instance of a source, relative to the directory of the manifest */
+TSP *corpus_load(char *manifest, char *source, uint *size, uint **distmat, double **points) {
+  uint seed = 0;
+  *size = 0;
+  *distmat = NULL;
+  *points = NULL;
+  if (sscanf(source, "random:%u:%u", size, &seed) == 2) *distmat = distmat_random(*size, seed, RANDOMMAX);
+  else if (sscanf(source, "points:%u:%u", size, &seed) == 2) *points = points_random(*size, seed, POINTMAX);
+  else {
+    char *slash = strrchr(manifest, '/');
+    size_t dirlen = slash ? (size_t)(slash - manifest + 1) : 0;
+    char *filename = malloc(dirlen + strlen(source) + 1);
+    assert(filename);
+    memcpy(filename, manifest, dirlen);
+    strcpy(filename + dirlen, source);
+    tsplib_load(filename, size, distmat, points);
+    free(filename);
+  }
+  assert(*size >= 2);
+  return *distmat ? tsp_new(*size, 0, *distmat, OPTIMIZE) : tsp_new_points(*size, 0, *points, OPTIMIZE);
+}
+
+/* ************************************************************************** */
+
+/* speed of this machine, as unit of normalized times: nodes per second of a fixed search without pruning */
+double corpus_calibrate(void) {
+  uint *distmat = distmat_random(CALIB_SIZE, 0, RANDOMMAX);
+  unsigned long long nodes = 0;
+  profile *timer = profile_new();
+  double seconds;
+  while ((seconds = profile_elapsed(timer)) < CALIB_SECONDS) {
+    TSP *tsp = tsp_new(CALIB_SIZE, 0, distmat, NONE);
+    path *sol = tsp_solve(tsp, NULL);
+    nodes += tsp_nodes(tsp);
+    path_free(sol);
+    tsp_free(tsp);
+  }
+  profile_free(timer);
+  free(distmat);
+  return nodes / seconds;
+}
+
+/* run an engine on an instance, and return its tour */
+path *corpus_run(TSP *tsp, char *engine) {
+  if (strcmp(engine, "exact") == 0) return tsp_solve(tsp, NULL);
+  if (strcmp(engine, "parallel") == 0) return tsp_solve_parallel(tsp, NULL);
+  path *tour = tsp_nearest(tsp);
+  if (tsp_symmetric(tsp)) tsp_2opt(tsp, tour, NULL);
+  else tsp_or3opt(tsp, tour, NULL, NULL);
+  if (strcmp(engine, "lns") == 0) tsp_lns(tsp, tour, NULL, 8, 1000, 0);
+  return tour;
+}
+
+/* ************************************************************************** */
+
+int main(int argc, char *argv[]) {
+  char *engine = "exact";
+  double maxgap = 10.0, slack = 0.0, tolerance = 50.0;
+  bool write = false;
+  uint probes = 0;
+  int c;
+  while ((c = getopt(argc, argv, "he:g:s:t:wx:")) != -1) {
+    if (c == 'e') engine = optarg;
+    if (c == 'g') maxgap = atof(optarg);
+    if (c == 's') slack = atof(optarg);
+    if (c == 't') tolerance = atof(optarg);
+    if (c == 'w') write = true;
+    if (c == 'x') probes = atoi(optarg);
+    if (c == 'h') usage(argc, argv);
+  }
+  if (optind != argc - 1) usage(argc, argv);
+  bool exact = (strcmp(engine, "exact") == 0 || strcmp(engine, "parallel") == 0);
+  if (!exact && strcmp(engine, "local") != 0 && strcmp(engine, "lns") != 0) usage(argc, argv);
+  if (probes == 1 || (probes > 0 && strcmp(engine, "exact") != 0)) usage(argc, argv);
+  char *manifest = argv[optind];
+  FILE *file = fopen(manifest, "r");
+  if (!file) {
+    fprintf(stderr, "Error: cannot read \"%s\"\n", manifest);
+    exit(EXIT_FAILURE);
+  }
+
+  /* times of the exact search are normalized by the speed of this machine, to be compared with baselines */
+  bool gated = (strcmp(engine, "exact") == 0); /* the parallel search explores another tree */
+  double rate = gated ? corpus_calibrate() : 0.0;
+  if (!write && gated) printf("Calibration: %.0f nodes per second.\n", rate);
+  if (!write) printf("%-12s %6s %10s %10s %8s %10s %12s %12s %10s %10s  %s\n", "instance", "size", "optimum", "dist",
+                     "gap(%)", "time(s)", "nodes", "baseline", "norm.time", "baseline", "status");
+  uint failed = 0, warned = 0, total = 0;
+  char line[MANIFEST_LINE];
+  while (fgets(line, MANIFEST_LINE, file)) {
+    char name[MANIFEST_LINE], source[MANIFEST_LINE];
+    uint optimum;
+    unsigned long long baseline;
+    double basetime = 0.0;
+    int nfields = sscanf(line, "%s %s %u %llu %lf", name, source, &optimum, &baseline, &basetime);
+    if (nfields < 4 || name[0] == '#') {
+      if (write) fputs(line, stdout); /* comments kept as is */
+      continue;
+    }
+    uint size, *distmat;
+    double *points;
+    TSP *tsp = corpus_load(manifest, source, &size, &distmat, &points);
+    estimate est = {0};
+    if (probes > 0) tsp_estimate(tsp, probes, 0, &est);
+    profile *timer = profile_new();
+    path *sol = corpus_run(tsp, engine);
+    double seconds = profile_elapsed(timer);
+    unsigned long long nodes = tsp_nodes(tsp);
+    double normtime = seconds * rate / 1e6;
+    uint dist = path_dist(sol);
+    double gap = 100.0 * ((double)dist - optimum) / optimum;
+
+    /* quality first: optimal distance of exact engines, and bounded gap of heuristics; then nodes as a hard gate,
+     * and normalized time only as a warning, as it still depends on the machine and its load */
+    char *status = "ok";
+    if (!tsp_check(tsp, sol)) status = "FAILED (invalid tour)";
+    else if (dist < optimum) status = "FAILED (below optimum)";
+    else if (exact && dist != optimum) status = "FAILED (not optimal)";
+    else if (!exact && gap > maxgap) status = "FAILED (gap)";
+    else if (gated && baseline > 0 && nodes > baseline * (1.0 + slack / 100.0)) status = "FAILED (nodes)";
+    else if (probes > 0 && (nodes < est.nodes_low / ESTIMATE_MARGIN || nodes > est.nodes_high * ESTIMATE_MARGIN))
+      status = "FAILED (estimate)";
+    else if (gated && basetime > 0.0 && normtime > basetime * (1.0 + tolerance / 100.0)) status = "WARNING (time)";
+    if (strncmp(status, "FAILED", 6) == 0) failed++;
+    if (strncmp(status, "WARNING", 7) == 0) warned++;
+    total++;
+    if (probes > 0 && !write)
+      printf("%-12s estimated %.3g nodes [%.3g, %.3g] with %u probes\n", name, est.nodes, est.nodes_low,
+             est.nodes_high, probes);
+    if (write && gated) printf("%s %s %u %llu %.3f\n", name, source, optimum, nodes, normtime);
+    else if (write) fputs(line, stdout);
+    else
+      printf("%-12s %6u %10u %10u %8.3f %10.4f %12llu %12llu %10.3f %10.3f  %s\n", name, size, optimum, dist, gap,
+             seconds, nodes, baseline, normtime, basetime, status);
+
+    profile_free(timer);
+    path_free(sol);
+    tsp_free(tsp);
+    free(distmat);
+    free(points);
+  }
+  fclose(file);
+  if (write) return EXIT_SUCCESS;
+  printf("%u instances, %u failed, %u slower than their baseline.\n", total, failed, warned);
+  huge_summary();
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* ************************************************************************** */
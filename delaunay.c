@@ -0,0 +1,493 @@
+/**
+ * @file delaunay.c
+ * @brief Delaunay triangulation (Guibas-Stolfi divide and conquer) as candidate graph, and greedy construction.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+/* ************************************************************************** */
+/*                                 QUAD-EDGES                                 */
+/* ************************************************************************** */
+
+/* quad-edge q holds the 4 directed edges 4q+r (r = 0, 2: the edge and its reverse, r = 1, 3: dual edges) */
+typedef struct quad {
+  uint *onext;   /* next edge ccw around the same origin */
+  uint *org;     /* origin city of primal edges */
+  double *pts;   /* city coordinates */
+  uint *free;    /* stack of deleted quad-edges, reused */
+  uint nfree;    /* nb of deleted quad-edges */
+  uint len;      /* nb of quad-edges allocated */
+  uint cap;      /* max nb of quad-edges */
+  bool *deleted; /* deleted quad-edges */
+} quad;
+
+static inline uint q_rot(uint e) { return (e & ~3u) | ((e + 1) & 3u); }
+static inline uint q_sym(uint e) { return (e & ~3u) | ((e + 2) & 3u); }
+static inline uint q_invrot(uint e) { return (e & ~3u) | ((e + 3) & 3u); }
+static inline uint q_onext(quad *Q, uint e) { return Q->onext[e]; }
+static inline uint q_oprev(quad *Q, uint e) { return q_rot(Q->onext[q_rot(e)]); }
+static inline uint q_lnext(quad *Q, uint e) { return q_rot(Q->onext[q_invrot(e)]); }
+static inline uint q_rprev(quad *Q, uint e) { return Q->onext[q_sym(e)]; }
+static inline uint q_org(quad *Q, uint e) { return Q->org[e]; }
+static inline uint q_dest(quad *Q, uint e) { return Q->org[q_sym(e)]; }
+
+/* ************************************************************************** */
+
+static uint quad_make(quad *Q, uint org, uint dest) {
+  uint q;
+  if (Q->nfree > 0) q = Q->free[--Q->nfree];
+  else {
+    assert(Q->len < Q->cap);
+    q = Q->len++;
+  }
+  uint e = 4 * q;
+  Q->deleted[q] = false;
+  Q->onext[e] = e;
+  Q->onext[e + 1] = e + 3;
+  Q->onext[e + 2] = e + 2;
+  Q->onext[e + 3] = e + 1;
+  Q->org[e] = org;
+  Q->org[e + 2] = dest;
+  return e;
+}
+
+static void quad_splice(quad *Q, uint a, uint b) {
+  uint alpha = q_rot(Q->onext[a]), beta = q_rot(Q->onext[b]);
+  uint tmp = Q->onext[a];
+  Q->onext[a] = Q->onext[b];
+  Q->onext[b] = tmp;
+  tmp = Q->onext[alpha];
+  Q->onext[alpha] = Q->onext[beta];
+  Q->onext[beta] = tmp;
+}
+
+/* new edge from the destination of a to the origin of b, in the left face of both */
+static uint quad_connect(quad *Q, uint a, uint b) {
+  uint e = quad_make(Q, q_dest(Q, a), q_org(Q, b));
+  quad_splice(Q, e, q_lnext(Q, a));
+  quad_splice(Q, q_sym(e), b);
+  return e;
+}
+
+static void quad_delete(quad *Q, uint e) {
+  quad_splice(Q, e, q_oprev(Q, e));
+  quad_splice(Q, q_sym(e), q_oprev(Q, q_sym(e)));
+  Q->deleted[e / 4] = true;
+  Q->free[Q->nfree++] = e / 4;
+}
+
+/* ************************************************************************** */
+/*                                PREDICATES                                  */
+/* ************************************************************************** */
+
+/* triangle abc is counterclockwise */
+static inline bool ccw(double *p, uint a, uint b, uint c) {
+  double ax = p[2 * a], ay = p[2 * a + 1];
+  return (p[2 * b] - ax) * (p[2 * c + 1] - ay) - (p[2 * b + 1] - ay) * (p[2 * c] - ax) > 0.0;
+}
+
+/* d strictly inside the circle through a, b, c (counterclockwise) */
+static inline bool incircle(double *p, uint a, uint b, uint c, uint d) {
+  long double dx = p[2 * d], dy = p[2 * d + 1];
+  long double ax = p[2 * a] - dx, ay = p[2 * a + 1] - dy;
+  long double bx = p[2 * b] - dx, by = p[2 * b + 1] - dy;
+  long double cx = p[2 * c] - dx, cy = p[2 * c + 1] - dy;
+  long double a2 = ax * ax + ay * ay, b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+  return ax * (by * c2 - b2 * cy) - ay * (bx * c2 - b2 * cx) + a2 * (bx * cy - by * cx) > 0.0L;
+}
+
+static inline bool rightof(quad *Q, uint x, uint e) { return ccw(Q->pts, x, q_dest(Q, e), q_org(Q, e)); }
+static inline bool leftof(quad *Q, uint x, uint e) { return ccw(Q->pts, x, q_org(Q, e), q_dest(Q, e)); }
+
+/* ************************************************************************** */
+/*                              DIVIDE AND CONQUER                            */
+/* ************************************************************************** */
+
+/* triangulation of cities s[0..n-1] sorted by x then y: set its ccw convex hull edge out of the leftmost city
+ * (le) and its cw convex hull edge out of the rightmost city (re) */
+static void delaunay_rec(quad *Q, uint *s, uint n, uint *le, uint *re) {
+  double *p = Q->pts;
+  if (n == 2) {
+    uint a = quad_make(Q, s[0], s[1]);
+    *le = a;
+    *re = q_sym(a);
+    return;
+  }
+  if (n == 3) {
+    uint a = quad_make(Q, s[0], s[1]);
+    uint b = quad_make(Q, s[1], s[2]);
+    quad_splice(Q, q_sym(a), b);
+    if (ccw(p, s[0], s[1], s[2])) {
+      quad_connect(Q, b, a);
+      *le = a;
+      *re = q_sym(b);
+    } else if (ccw(p, s[0], s[2], s[1])) {
+      uint c = quad_connect(Q, b, a);
+      *le = q_sym(c);
+      *re = c;
+    } else { /* collinear */
+      *le = a;
+      *re = q_sym(b);
+    }
+    return;
+  }
+
+  uint ldo, ldi, rdi, rdo;
+  delaunay_rec(Q, s, n / 2, &ldo, &ldi);
+  delaunay_rec(Q, s + n / 2, n - n / 2, &rdi, &rdo);
+
+  /* lower common tangent of both hulls */
+  for (;;) {
+    if (leftof(Q, q_org(Q, rdi), ldi)) ldi = q_lnext(Q, ldi);
+    else if (rightof(Q, q_org(Q, ldi), rdi)) rdi = q_rprev(Q, rdi);
+    else break;
+  }
+  uint basel = quad_connect(Q, q_sym(rdi), ldi);
+  if (q_org(Q, ldi) == q_org(Q, ldo)) ldo = q_sym(basel);
+  if (q_org(Q, rdi) == q_org(Q, rdo)) rdo = basel;
+
+  /* merge upwards, adding cross edges whose circle is empty, deleting the edges they cross */
+  for (;;) {
+    uint lcand = q_onext(Q, q_sym(basel));
+    bool lvalid = rightof(Q, q_dest(Q, lcand), basel);
+    if (lvalid)
+      while (incircle(p, q_dest(Q, basel), q_org(Q, basel), q_dest(Q, lcand), q_dest(Q, q_onext(Q, lcand)))) {
+        uint t = q_onext(Q, lcand);
+        quad_delete(Q, lcand);
+        lcand = t;
+      }
+    uint rcand = q_oprev(Q, basel);
+    bool rvalid = rightof(Q, q_dest(Q, rcand), basel);
+    if (rvalid)
+      while (incircle(p, q_dest(Q, basel), q_org(Q, basel), q_dest(Q, rcand), q_dest(Q, q_oprev(Q, rcand)))) {
+        uint t = q_oprev(Q, rcand);
+        quad_delete(Q, rcand);
+        rcand = t;
+      }
+    lvalid = rightof(Q, q_dest(Q, lcand), basel);
+    rvalid = rightof(Q, q_dest(Q, rcand), basel);
+    if (!lvalid && !rvalid) break;
+    if (!lvalid || (rvalid && incircle(p, q_dest(Q, lcand), q_org(Q, lcand), q_org(Q, rcand), q_dest(Q, rcand))))
+      basel = quad_connect(Q, rcand, q_sym(basel));
+    else basel = quad_connect(Q, q_sym(basel), q_sym(lcand));
+  }
+  *le = ldo;
+  *re = rdo;
+}
+
+/* ************************************************************************** */
+
+typedef struct dpoint {
+  double x, y;
+  uint city;
+} dpoint;
+
+static int delaunay_cmp(const void *a, const void *b) {
+  const dpoint *p = a, *q = b;
+  if (p->x != q->x) return (p->x < q->x) ? -1 : 1;
+  if (p->y != q->y) return (p->y < q->y) ? -1 : 1;
+  return (p->city < q->city) ? -1 : (p->city > q->city);
+}
+
+/* ************************************************************************** */
+
+cand *cand_delaunay(TSP *tsp) {
+  assert(tsp && tsp->points);
+  uint n = tsp->size;
+  double *p = tsp->points;
+
+  /* cities sorted by x then y, duplicates linked to the first city at the same place only */
+  dpoint *sorted = malloc(n * sizeof(dpoint));
+  uint *s = malloc(n * sizeof(uint));
+  uint *rep = malloc(n * sizeof(uint));
+  assert(sorted && s && rep);
+  for (uint i = 0; i < n; i++) sorted[i] = (dpoint){p[2 * i], p[2 * i + 1], i};
+  qsort(sorted, n, sizeof(dpoint), delaunay_cmp);
+  uint m = 0;
+  for (uint i = 0; i < n; i++) {
+    bool dup = (i > 0 && sorted[i].x == sorted[i - 1].x && sorted[i].y == sorted[i - 1].y);
+    rep[sorted[i].city] = dup ? s[m - 1] : sorted[i].city;
+    if (!dup) s[m++] = sorted[i].city;
+  }
+  free(sorted);
+
+  /* at most 3m-6 edges at any time of the merge, as deleted quad-edges are reused */
+  quad Q = {0};
+  Q.pts = p;
+  Q.cap = 3 * m + 3;
+  Q.onext = malloc(4 * (size_t)Q.cap * sizeof(uint));
+  Q.org = malloc(4 * (size_t)Q.cap * sizeof(uint));
+  Q.free = malloc(Q.cap * sizeof(uint));
+  Q.deleted = malloc(Q.cap * sizeof(bool));
+  assert(Q.onext && Q.org && Q.free && Q.deleted);
+  uint le, re;
+  if (m >= 2) delaunay_rec(&Q, s, m, &le, &re);
+
+  /* candidate lists: triangulation edges, plus duplicates with their first city, sorted by distance */
+  cand *c = malloc(sizeof(cand));
+  assert(c);
+  c->size = n;
+  c->start = huge_map((n + 1) * sizeof(uint));
+  for (uint q = 0; q < Q.len; q++)
+    if (!Q.deleted[q]) {
+      c->start[Q.org[4 * q] + 1]++;
+      c->start[Q.org[4 * q + 2] + 1]++;
+    }
+  for (uint i = 0; i < n; i++)
+    if (rep[i] != i) {
+      c->start[i + 1]++;
+      c->start[rep[i] + 1]++;
+    }
+  for (uint i = 0; i < n; i++) c->start[i + 1] += c->start[i];
+  c->adj = huge_map((c->start[n] + 1) * sizeof(uint));
+  uint *len = calloc(n, sizeof(uint));
+  assert(len);
+  for (uint q = 0; q < Q.len; q++)
+    if (!Q.deleted[q]) {
+      uint a = Q.org[4 * q], b = Q.org[4 * q + 2];
+      c->adj[c->start[a] + len[a]++] = b;
+      c->adj[c->start[b] + len[b]++] = a;
+    }
+  for (uint i = 0; i < n; i++)
+    if (rep[i] != i) {
+      c->adj[c->start[i] + len[i]++] = rep[i];
+      c->adj[c->start[rep[i]] + len[rep[i]]++] = i;
+    }
+  for (uint i = 0; i < n; i++) /* insertion sort of short lists */
+    for (uint k = c->start[i] + 1; k < c->start[i + 1]; k++) {
+      uint city = c->adj[k], d = tsp_dist(tsp, i, city);
+      uint l = k;
+      while (l > c->start[i] && tsp_dist(tsp, i, c->adj[l - 1]) > d) {
+        c->adj[l] = c->adj[l - 1];
+        l--;
+      }
+      c->adj[l] = city;
+    }
+
+  free(len);
+  free(Q.onext);
+  free(Q.org);
+  free(Q.free);
+  free(Q.deleted);
+  free(rep);
+  free(s);
+  return c;
+}
+
+/* ************************************************************************** */
+/*                                  GREEDY                                    */
+/* ************************************************************************** */
+
+typedef struct gedge {
+  uint dist;
+  uint a, b;
+} gedge;
+
+static int greedy_cmp(const void *x, const void *y) {
+  const gedge *e = x, *f = y;
+  if (e->dist != f->dist) return (e->dist < f->dist) ? -1 : 1;
+  if (e->a != f->a) return (e->a < f->a) ? -1 : 1;
+  return (e->b < f->b) ? -1 : (e->b > f->b);
+}
+
+static uint greedy_find(uint *uf, uint i) {
+  while (uf[i] != i) i = uf[i] = uf[uf[i]];
+  return i;
+}
+
+/* ************************************************************************** */
+
+/* endpoints of the fragments not yet in the tour, in a uniform grid (geometric instances) or a plain list */
+typedef struct egrid {
+  double *pts;   /* city coordinates (or NULL) */
+  uint g;        /* nb of cells per side */
+  double x0, y0; /* lower left corner */
+  double w;      /* cell width */
+  uint *start;   /* endpoints of cell c in items[start[c] ... start[c]+live[c]-1] */
+  uint *live;    /* nb of endpoints left in each cell */
+  uint *items;   /* endpoints by cell */
+  uint *pos;     /* position of each city in items */
+} egrid;
+
+static uint egrid_cell(egrid *G, uint city) {
+  if (!G->pts) return 0;
+  int cx = (int)((G->pts[2 * city] - G->x0) / G->w), cy = (int)((G->pts[2 * city + 1] - G->y0) / G->w);
+  if (cx >= (int)G->g) cx = G->g - 1;
+  if (cy >= (int)G->g) cy = G->g - 1;
+  return cy * G->g + cx;
+}
+
+static void egrid_init(egrid *G, TSP *tsp, uint *ends, uint m) {
+  G->pts = tsp->points;
+  G->g = 1;
+  G->x0 = G->y0 = 0.0;
+  G->w = 1.0;
+  if (G->pts) {
+    double x1 = -DBL_MAX, y1 = -DBL_MAX;
+    G->x0 = G->y0 = DBL_MAX;
+    for (uint i = 0; i < m; i++) {
+      double x = G->pts[2 * ends[i]], y = G->pts[2 * ends[i] + 1];
+      if (x < G->x0) G->x0 = x;
+      if (y < G->y0) G->y0 = y;
+      if (x > x1) x1 = x;
+      if (y > y1) y1 = y;
+    }
+    G->g = (uint)sqrt(m / 2.0) + 1; /* about 2 endpoints per cell */
+    double side = (x1 - G->x0 > y1 - G->y0) ? x1 - G->x0 : y1 - G->y0;
+    G->w = (side > 0.0) ? side / G->g * (1.0 + 1e-9) : 1.0;
+  }
+  uint ncells = G->g * G->g;
+  G->start = calloc(ncells + 1, sizeof(uint));
+  G->live = calloc(ncells, sizeof(uint));
+  G->items = malloc(m * sizeof(uint));
+  G->pos = malloc(tsp->size * sizeof(uint));
+  assert(G->start && G->live && G->items && G->pos);
+  for (uint i = 0; i < m; i++) G->start[egrid_cell(G, ends[i]) + 1]++;
+  for (uint c = 0; c < ncells; c++) G->start[c + 1] += G->start[c];
+  for (uint i = 0; i < m; i++) {
+    uint c = egrid_cell(G, ends[i]);
+    G->pos[ends[i]] = G->start[c] + G->live[c];
+    G->items[G->start[c] + G->live[c]++] = ends[i];
+  }
+}
+
+static void egrid_remove(egrid *G, uint city) {
+  uint c = egrid_cell(G, city);
+  uint last = G->items[G->start[c] + --G->live[c]];
+  G->items[G->pos[city]] = last;
+  G->pos[last] = G->pos[city];
+}
+
+/* nearest endpoint left from a city, searched in rings of cells around it (or n if none) */
+static uint egrid_nearest(egrid *G, TSP *tsp, uint from) {
+  uint best = tsp->size, bestd = 0;
+  int g = G->g;
+  int cx = 0, cy = 0;
+  if (G->pts) {
+    cx = (int)((G->pts[2 * from] - G->x0) / G->w);
+    cy = (int)((G->pts[2 * from + 1] - G->y0) / G->w);
+  }
+  for (int r = 0; r < 2 * g + 1; r++) {
+    /* endpoints of rings r and beyond are at least r-1 cell widths away */
+    if (best < tsp->size && bestd + 1.0 <= (r - 1) * G->w) break;
+    for (int y = cy - r; y <= cy + r; y++) {
+      if (y < 0 || y >= g) continue;
+      int step = (y == cy - r || y == cy + r) ? 1 : 2 * r;
+      for (int x = cx - r; x <= cx + r; x += (step > 0) ? step : 1) {
+        if (x < 0 || x >= g) continue;
+        uint c = y * g + x;
+        for (uint k = G->start[c]; k < G->start[c] + G->live[c]; k++) {
+          uint d = tsp_dist(tsp, from, G->items[k]);
+          if (best == tsp->size || d < bestd || (d == bestd && G->items[k] < best)) {
+            best = G->items[k];
+            bestd = d;
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
+
+static void egrid_free(egrid *G) {
+  free(G->start);
+  free(G->live);
+  free(G->items);
+  free(G->pos);
+}
+
+/* ************************************************************************** */
+
+path *tsp_greedy(TSP *tsp, cand *c) {
+  assert(tsp);
+  uint n = tsp->size;
+  if (!c) c = tsp->cand;
+  cand *own = c ? NULL : tsp->points ? cand_delaunay(tsp) : cand_knn(tsp, 8);
+  if (!c) c = own;
+
+  /* shortest candidate edges first, unless they make a degree 3 or close a cycle */
+  gedge *edges = malloc((c->start[n] + 1) * sizeof(gedge));
+  uint *uf = malloc(n * sizeof(uint));
+  uint *deg = calloc(n, sizeof(uint));
+  uint *nbr = malloc(2 * n * sizeof(uint));
+  assert(edges && uf && deg && nbr);
+  uint nedges = 0;
+  for (uint a = 0; a < n; a++)
+    for (uint k = c->start[a]; k < c->start[a + 1]; k++)
+      if (a < c->adj[k]) edges[nedges++] = (gedge){tsp_dist(tsp, a, c->adj[k]), a, c->adj[k]};
+  qsort(edges, nedges, sizeof(gedge), greedy_cmp);
+  for (uint i = 0; i < n; i++) uf[i] = i;
+  uint nfrag = n;
+  for (uint e = 0; e < nedges && nfrag > 1; e++) {
+    uint a = edges[e].a, b = edges[e].b;
+    if (deg[a] == 2 || deg[b] == 2) continue;
+    uint ra = greedy_find(uf, a), rb = greedy_find(uf, b);
+    if (ra == rb) continue;
+    uf[ra] = rb;
+    nbr[2 * a + deg[a]++] = b;
+    nbr[2 * b + deg[b]++] = a;
+    nfrag--;
+  }
+
+  /* fragments joined by nearest endpoints, from the fragment of the first city */
+  uint *ends = malloc(n * sizeof(uint));
+  assert(ends);
+  uint m = 0;
+  for (uint i = 0; i < n; i++)
+    if (deg[i] < 2) ends[m++] = i;
+  egrid G;
+  egrid_init(&G, tsp, ends, m);
+  uint *cycle = malloc(n * sizeof(uint));
+  assert(cycle);
+  uint len = 0;
+  uint x = tsp->first;
+  if (deg[x] == 2) /* walk to an end of its fragment, if any */
+    for (uint prev = n, cur = x;;) {
+      uint next = (nbr[2 * cur] != prev) ? nbr[2 * cur] : nbr[2 * cur + 1];
+      prev = cur;
+      cur = next;
+      if (deg[cur] < 2 || cur == x) {
+        x = cur;
+        break;
+      }
+    }
+  while (x < n) {
+    /* append the fragment from its end x to its other end */
+    if (deg[x] < 2) egrid_remove(&G, x);
+    uint prev = n, cur = x;
+    for (;;) {
+      cycle[len++] = cur;
+      uint next = n;
+      for (uint k = 0; k < deg[cur]; k++)
+        if (nbr[2 * cur + k] != prev) next = nbr[2 * cur + k];
+      if (next == n || next == x) break;
+      prev = cur;
+      cur = next;
+    }
+    if (cur != x && deg[cur] < 2) egrid_remove(&G, cur);
+    x = egrid_nearest(&G, tsp, cur);
+  }
+  assert(len == n);
+  path *p = path_from_cycle(tsp, cycle, n);
+
+  egrid_free(&G);
+  free(cycle);
+  free(ends);
+  free(nbr);
+  free(deg);
+  free(uf);
+  free(edges);
+  cand_free(own);
+  return p;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,581 @@
+/**
+ * @file difftest.c
+ * @brief Differential testing of the exact engines on random instances, with automatic minimization of failures.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tsp.h"
+
+#define CHECKPOINT "difftest.ckpt" /* checkpoint file of the resumed search */
+#define RESUME_LIMIT 37            /* nb of nodes before the resumed search stops */
+#define MAXSIZE 14                 /* max size of instances, for the Held-Karp oracle */
+#define BRUTE_MAXSIZE 10           /* max size of instances for the engines without pruning */
+#define SYM_MAXSIZE 5              /* max size of instances solved on their symmetric transformation */
+#define CANONICAL_SIZE 6           /* size of the instance whose tours are all normalized and hashed */
+
+/* ************************************************************************** */
+
+/* instance as a distance matrix, or city coordinates given to engines as such */
+typedef struct instance {
+  uint size;
+  uint first;
+  unsigned char options; /* objective: BOTTLENECK and OPENPATH */
+  bool symmetric;        /* distance matrix kept symmetric by minimization */
+  uint *distmat;         /* distances (also of city coordinates, for the oracle) */
+  double *points;        /* city coordinates (or NULL) */
+} instance;
+
+static const char *structures[] = {"symmetric", "ties", "asymmetric", "points", "clusters"};
+#define NSTRUCTURES 5
+
+static unsigned long long rng_state = 1;
+
+static uint rng(uint max) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (uint)((rng_state >> 32) % max);
+}
+
+/* ************************************************************************** */
+
+void usage(int argc, char *argv[]) {
+  printf("Usage: %s [options]\n", argv[0]);
+  printf("Compare all exact engines on random instances, and minimize the first failing one.\n");
+  printf("Structures: symmetric, ties (few distinct distances), asymmetric, points and clusters (coordinates).\n");
+  printf("Objectives: closed tour or open path, min-sum or bottleneck.\n");
+  printf("Options:\n");
+  printf(" -n count: nb of instances [default: 100]\n");
+  printf(" -m size: max size of instances, from 2 to %u [default: 9]\n", MAXSIZE);
+  printf(" -s seed: random seed [default: 1]\n");
+  printf(" -o filename: save the minimized failing instance as a distance matrix, and the solve command with its\n");
+  printf("   first city and objective as filename.sh [default: difftest.txt]\n");
+  printf(" -h: print usage\n");
+  exit(EXIT_FAILURE);
+}
+
+/* ************************************************************************** */
+/*                                 INSTANCES                                  */
+/* ************************************************************************** */
+
+static void instance_dists(instance *in) {
+  for (uint i = 0; i < in->size; i++)
+    for (uint j = 0; j < in->size; j++) {
+      double dx = in->points[2 * i] - in->points[2 * j], dy = in->points[2 * i + 1] - in->points[2 * j + 1];
+      in->distmat[i * in->size + j] = (uint)(sqrt(dx * dx + dy * dy) + 0.5); /* as tsp_new_points */
+    }
+}
+
+/* ************************************************************************** */
+
+static instance *instance_random(uint size, uint structure) {
+  instance *in = calloc(1, sizeof(instance));
+  assert(in);
+  in->size = size;
+  in->first = rng(size);
+  in->options = (rng(2) ? BOTTLENECK : 0) | (rng(2) ? OPENPATH : 0);
+  in->symmetric = (structure != 2);
+  in->distmat = malloc(size * size * sizeof(uint));
+  assert(in->distmat);
+  if (structure <= 2) {
+    uint max = (structure == 1) ? 3 : 100;
+    for (uint i = 0; i < size; i++)
+      for (uint j = 0; j < size; j++) in->distmat[i * size + j] = (i == j) ? 0 : 1 + rng(max);
+    if (in->symmetric)
+      for (uint i = 0; i < size; i++)
+        for (uint j = 0; j < i; j++) in->distmat[j * size + i] = in->distmat[i * size + j];
+    return in;
+  }
+  in->points = malloc(2 * size * sizeof(double));
+  assert(in->points);
+  uint nclusters = 1 + rng(3);
+  for (uint i = 0; i < size; i++)
+    for (uint k = 0; k < 2; k++) {
+      double center = (structure == 4) ? 200.0 * (1 + (i % nclusters) * 2) : 0.0;
+      double spread = (structure == 4) ? 20.0 : 1000.0;
+      in->points[2 * i + k] = center + rng(1000000) * spread / 1000000.0;
+    }
+  instance_dists(in);
+  return in;
+}
+
+/* ************************************************************************** */
+
+static void instance_free(instance *in) {
+  if (in) {
+    free(in->distmat);
+    free(in->points);
+  }
+  free(in);
+}
+
+/* ************************************************************************** */
+
+/* copy of an instance without one city */
+static instance *instance_remove(instance *in, uint city) {
+  instance *out = calloc(1, sizeof(instance));
+  assert(out);
+  *out = *in;
+  out->size = in->size - 1;
+  out->first = (in->first > city) ? in->first - 1 : in->first;
+  out->distmat = malloc(out->size * out->size * sizeof(uint));
+  assert(out->distmat);
+  for (uint i = 0, k = 0; i < in->size; i++)
+    for (uint j = 0; j < in->size; j++)
+      if (i != city && j != city) out->distmat[k++] = in->distmat[i * in->size + j];
+  if (in->points) {
+    out->points = malloc(2 * out->size * sizeof(double));
+    assert(out->points);
+    for (uint i = 0, k = 0; i < in->size; i++)
+      if (i != city) {
+        out->points[2 * k] = in->points[2 * i];
+        out->points[2 * k++ + 1] = in->points[2 * i + 1];
+      }
+  }
+  return out;
+}
+
+/* ************************************************************************** */
+
+static TSP *instance_tsp(instance *in, unsigned char options) {
+  if (in->points) return tsp_new_points(in->size, in->first, in->points, options);
+  return tsp_new(in->size, in->first, in->distmat, options);
+}
+
+/* ************************************************************************** */
+/*                                  ORACLE                                    */
+/* ************************************************************************** */
+
+/* Held-Karp dynamic programming over subsets, for both objectives, closed or open, without missing arcs */
+static uint oracle(instance *in) {
+  uint n = in->size, f = in->first;
+  bool bottleneck = in->options & BOTTLENECK;
+  uint *dp = malloc(((size_t)1 << n) * n * sizeof(uint)); /* best path from f through the subset, ending at j */
+  assert(dp);
+  for (size_t k = 0; k < ((size_t)1 << n) * n; k++) dp[k] = UINT_MAX;
+  dp[((size_t)1 << f) * n + f] = 0;
+  for (size_t mask = 1; mask < ((size_t)1 << n); mask++) {
+    if (!(mask >> f & 1)) continue;
+    for (uint j = 0; j < n; j++) {
+      uint v = dp[mask * n + j];
+      if (v == UINT_MAX) continue;
+      for (uint k = 0; k < n; k++) {
+        if (mask >> k & 1) continue;
+        uint d = in->distmat[j * n + k];
+        if (d == DIST_INF) continue;
+        uint w = bottleneck ? (v > d ? v : d) : v + d;
+        size_t slot = (mask | ((size_t)1 << k)) * n + k;
+        if (w < dp[slot]) dp[slot] = w;
+      }
+    }
+  }
+  uint best = UINT_MAX;
+  size_t full = ((size_t)1 << n) - 1;
+  for (uint j = 0; j < n; j++) {
+    uint v = dp[full * n + j];
+    if (v == UINT_MAX || (j == f && n > 1)) continue;
+    if (!(in->options & OPENPATH)) {
+      uint d = in->distmat[j * n + f];
+      if (d == DIST_INF) continue;
+      v = bottleneck ? (v > d ? v : d) : v + d;
+    }
+    if (v < best) best = v;
+  }
+  free(dp);
+  return best;
+}
+
+/* shortest path closure by Floyd-Warshall, on the arcs other than DIST_INF */
+static uint *oracle_closure(uint n, uint *distmat) {
+  uint *dist = malloc(n * n * sizeof(uint));
+  assert(dist);
+  for (uint i = 0; i < n * n; i++) dist[i] = distmat[i];
+  for (uint i = 0; i < n; i++) dist[i * n + i] = 0;
+  for (uint k = 0; k < n; k++)
+    for (uint i = 0; i < n; i++)
+      for (uint j = 0; j < n; j++) {
+        uint ik = dist[i * n + k], kj = dist[k * n + j];
+        if (ik != DIST_INF && kj != DIST_INF && ik + kj < dist[i * n + j]) dist[i * n + j] = ik + kj;
+      }
+  return dist;
+}
+
+/* ************************************************************************** */
+/*                                  ENGINES                                   */
+/* ************************************************************************** */
+
+/* check a tour of an engine: valid, and optimal; return a failure message, or NULL */
+static char *check(TSP *tsp, path *sol, uint optimum, char *engine, char *msg) {
+  if (!tsp_check(tsp, sol)) sprintf(msg, "%s: invalid tour", engine);
+  else if (path_dist(sol) != optimum) sprintf(msg, "%s: distance %u instead of %u", engine, path_dist(sol), optimum);
+  else return NULL;
+  return msg;
+}
+
+/* ************************************************************************** */
+
+/* check a shortest path closure and its first cities against the original arcs and Floyd-Warshall; return a
+ * failure message, or NULL */
+static char *check_closure(uint n, uint *distmat, uint *closure, uint *next, char *msg) {
+  uint *dist = oracle_closure(n, distmat);
+  char *failure = NULL;
+  for (uint i = 0; i < n && !failure; i++)
+    for (uint j = 0; j < n && !failure; j++) {
+      uint len = 0, c = i;
+      for (uint steps = 0; c != j && steps < n && len != DIST_INF; steps++) { /* walk on the original arcs */
+        uint to = next[c * n + j];
+        len = (distmat[c * n + to] == DIST_INF) ? DIST_INF : len + distmat[c * n + to];
+        c = to;
+      }
+      if (c != j) len = DIST_INF;
+      if (closure[i * n + j] != dist[i * n + j])
+        sprintf(msg, "distmat_closure: distance %u instead of %u from %u to %u", closure[i * n + j], dist[i * n + j],
+                i, j);
+      else if (len != dist[i * n + j]) sprintf(msg, "distmat_closure: path of length %u from %u to %u", len, i, j);
+      else continue;
+      failure = msg;
+    }
+  free(dist);
+  return failure;
+}
+
+/* ************************************************************************** */
+
+/* run all exact engines, and return the first failure (in msg), or NULL */
+static char *difftest(instance *in, char *msg) {
+  uint optimum = oracle(in);
+  char *failure = NULL;
+
+  /* reference: recursive search without pruning, which returns the lexicographically smallest optimal tour */
+  TSP *tsp;
+  path *ref = NULL;
+  if (in->size <= BRUTE_MAXSIZE) {
+    tsp = instance_tsp(in, in->options);
+    ref = tsp_solve(tsp, NULL);
+    failure = check(tsp, ref, optimum, "tsp_solve", msg);
+    tsp_free(tsp);
+  }
+
+  /* iterator over all tours, in the same order */
+  if (!failure && ref) {
+    tsp = instance_tsp(in, in->options);
+    tsp_iter *it = tsp_iter_new(tsp);
+    path *p = path_new(in->size + 1, 0), *best = path_new(in->size + 1, UINT_MAX);
+    while (tsp_iter_next(it, p))
+      if (path_dist(p) < path_dist(best)) { /* keep the first best tour */
+        path *tmp = best;
+        best = p;
+        p = tmp;
+      }
+    failure = check(tsp, best, optimum, "tsp_iter", msg);
+    if (!failure && !path_equal(best, ref)) failure = strcpy(msg, "tsp_iter: another optimal tour than tsp_solve");
+    path_free(p);
+    path_free(best);
+    tsp_iter_free(it);
+    tsp_free(tsp);
+  }
+
+  /* branch and bound: same tour as the reference */
+  path *opt = NULL;
+  uint optcount = 0;
+  unsigned long long optnodes = 0;
+  if (!failure) {
+    tsp = instance_tsp(in, in->options | OPTIMIZE);
+    opt = tsp_solve(tsp, &optcount);
+    optnodes = tsp_nodes(tsp);
+    failure = check(tsp, opt, optimum, "tsp_solve (optimize)", msg);
+    if (!failure && ref && !path_equal(opt, ref))
+      failure = strcpy(msg, "tsp_solve (optimize): another optimal tour than without pruning");
+    tsp_free(tsp);
+  }
+
+  /* deterministic parallel search: same tour as the sequential one */
+  if (!failure) {
+    tsp = instance_tsp(in, in->options | OPTIMIZE);
+    path *sol = tsp_solve_parallel(tsp, NULL);
+    failure = check(tsp, sol, optimum, "tsp_solve_parallel", msg);
+    if (!failure && !path_equal(sol, opt))
+      failure = strcpy(msg, "tsp_solve_parallel: another optimal tour than the sequential search");
+    path_free(sol);
+    tsp_free(tsp);
+  }
+
+  /* search stopped at a node limit, then resumed from its checkpoint in a new instance: same tour, nb of
+   * solutions and nodes as the uninterrupted search */
+  if (!failure) {
+    tsp = instance_tsp(in, in->options | OPTIMIZE);
+    tsp_set_checkpoint(tsp, CHECKPOINT, 0, RESUME_LIMIT);
+    uint count = 0;
+    path *sol = tsp_solve(tsp, &count);
+    unsigned long long nodes = tsp_nodes(tsp);
+    if (tsp_stopped(tsp)) {
+      path_free(sol);
+      TSP *again = instance_tsp(in, in->options | OPTIMIZE);
+      tsp_resume(again, CHECKPOINT);
+      count = 0;
+      sol = tsp_solve(again, &count);
+      nodes = tsp_nodes(again);
+      tsp_free(again);
+    }
+    failure = check(tsp, sol, optimum, "tsp_resume", msg);
+    if (!failure && !path_equal(sol, opt))
+      failure = strcpy(msg, "tsp_resume: another optimal tour than the uninterrupted search");
+    if (!failure && (count != optcount || nodes != optnodes)) {
+      sprintf(msg, "tsp_resume: %u solutions and %llu nodes instead of %u and %llu", count, nodes, optcount, optnodes);
+      failure = msg;
+    }
+    remove(CHECKPOINT);
+    path_free(sol);
+    tsp_free(tsp);
+  }
+
+  /* warm start from an elite pool with a heuristic tour (closed tours only), sequential then parallel: still
+   * the lexicographically smallest optimal tour, even if the heuristic tour is another optimal one */
+  for (uint parallel = 0; parallel < 2 && !failure && !(in->options & OPENPATH); parallel++) {
+    tsp = instance_tsp(in, in->options | OPTIMIZE);
+    elite *pool = elite_new(tsp, 2);
+    path *start = tsp_nearest(tsp);
+    elite_insert(pool, start);
+    tsp_set_elite(tsp, pool);
+    path *sol = parallel ? tsp_solve_parallel(tsp, NULL) : tsp_solve(tsp, NULL);
+    char *engine = parallel ? "tsp_solve_parallel (elite warm start)" : "tsp_solve (elite warm start)";
+    failure = check(tsp, sol, optimum, engine, msg);
+    if (!failure && !path_equal(sol, opt)) {
+      sprintf(msg, "%s: another optimal tour than without warm start", engine);
+      failure = msg;
+    }
+    path_free(sol);
+    path_free(start);
+    elite_free(pool);
+    tsp_free(tsp);
+  }
+
+  /* exact search on the symmetric transformation (closed tours of sum only), mapped back */
+  if (!failure && in->size <= SYM_MAXSIZE && !(in->options & (BOTTLENECK | OPENPATH))) {
+    tsp = instance_tsp(in, OPTIMIZE);
+    TSP *sym = tsp_new_sym(tsp);
+    path *tour = tsp_solve(sym, NULL);
+    path *sol = path_from_sym(sym, tour);
+    failure = check(tsp, sol, optimum, "tsp_new_sym", msg);
+    path_free(sol);
+    path_free(tour);
+    tsp_free(sym);
+    tsp_free(tsp);
+  }
+
+  /* instance with missing arcs, all but a cycle through all cities and a dense subset (or none, sparse enough
+   * for Dijkstra from 10 cities): solved directly, never using the missing arcs, then on its shortest path
+   * closure against Held-Karp on the Floyd-Warshall closure */
+  for (uint sparse = 0; sparse < 2 && !failure; sparse++) {
+    uint n = in->size;
+    uint *arcs = malloc(n * n * sizeof(uint));
+    uint *next = malloc(n * n * sizeof(uint));
+    assert(arcs && next);
+    for (uint i = 0; i < n; i++)
+      for (uint j = 0; j < n; j++) {
+        bool cycle = (j == (i + 1) % n) || (in->symmetric && !sparse && i == (j + 1) % n);
+        bool kept = cycle || (!sparse && (i + j + i * j) % 3 == 0); /* symmetric rule */
+        arcs[i * n + j] = (i == j || kept) ? in->distmat[i * n + j] : DIST_INF;
+      }
+    instance direct = *in;
+    direct.distmat = arcs;
+    direct.points = NULL;
+    uint best = oracle(&direct); /* some tour follows the cycle */
+    char *engines[] = {"tsp_solve (missing arcs)", "tsp_solve (optimize, missing arcs)",
+                       "tsp_solve_parallel (missing arcs)"};
+    for (uint engine = (n > BRUTE_MAXSIZE) ? 1 : 0; engine < 3 && !failure; engine++) {
+      tsp = tsp_new(n, in->first, arcs, in->options | (engine > 0 ? OPTIMIZE : 0));
+      path *sol = (engine == 2) ? tsp_solve_parallel(tsp, NULL) : tsp_solve(tsp, NULL);
+      failure = check(tsp, sol, best, engines[engine], msg);
+      path_free(sol);
+      tsp_free(tsp);
+    }
+    uint *closure = failure ? NULL : distmat_closure(n, arcs, next);
+    if (!failure) failure = check_closure(n, arcs, closure, next, msg);
+    if (!failure) {
+      instance metric = *in;
+      metric.distmat = oracle_closure(n, arcs);
+      metric.points = NULL;
+      tsp = tsp_new(n, in->first, closure, in->options | OPTIMIZE);
+      path *sol = tsp_solve(tsp, NULL);
+      failure = check(tsp, sol, oracle(&metric), sparse ? "tsp_solve (sparse closure)" : "tsp_solve (closure)", msg);
+      path_free(sol);
+      tsp_free(tsp);
+      free(metric.distmat);
+    }
+    free(closure);
+    free(next);
+    free(arcs);
+  }
+
+  path_free(opt);
+  path_free(ref);
+  return failure;
+}
+
+/* ************************************************************************** */
+
+/* Canonical form and hash of all tours from every first city, that is all rotations and reflections of
+ * each tour: each of the (n-1)!/2 distinct tours must have one canonical form and one hash, reached by
+ * its 2n rotations and reflections, and distinct tours distinct ones. Return a failure message, or NULL. */
+static char *difftest_canonical(uint n, char *msg) {
+  uint ntours = 1;
+  for (uint i = 3; i < n; i++) ntours *= i; /* (n-1)!/2 */
+  path **forms = malloc(ntours * sizeof(path *));
+  unsigned long long *hashes = malloc(ntours * sizeof(unsigned long long));
+  uint *counts = calloc(ntours, sizeof(uint));
+  uint *distmat = calloc(n * n, sizeof(uint));
+  assert(forms && hashes && counts && distmat);
+  uint len = 0;
+  char *failure = NULL;
+  for (uint first = 0; first < n && !failure; first++) {
+    TSP *tsp = tsp_new(n, first, distmat, NONE);
+    tsp_iter *it = tsp_iter_new(tsp);
+    path *p = path_new(n + 1, 0);
+    while (!failure && tsp_iter_next(it, p)) {
+      unsigned long long h = path_hash(p);
+      path_canonical(p);
+      uint k = 0;
+      while (k < len && !path_equal(p, forms[k])) k++;
+      if (path_hash(p) != h) failure = strcpy(msg, "path_hash: another hash for the canonical tour");
+      else if (k < len && hashes[k] != h)
+        failure = strcpy(msg, "path_hash: another hash for a rotation or reflection");
+      else if (k == len && len == ntours) failure = strcpy(msg, "path_canonical: more canonical forms than tours");
+      else if (k == len) { /* new canonical form, kept */
+        forms[len] = p;
+        hashes[len++] = h;
+        p = path_new(n + 1, 0);
+      }
+      if (!failure) counts[k]++;
+    }
+    path_free(p);
+    tsp_iter_free(it);
+    tsp_free(tsp);
+  }
+  for (uint k = 0; k < len && !failure; k++) {
+    if (counts[k] != 2 * n) {
+      sprintf(msg, "path_canonical: %u rotations and reflections of a tour instead of %u", counts[k], 2 * n);
+      failure = msg;
+    }
+    for (uint l = 0; l < k && !failure; l++)
+      if (hashes[l] == hashes[k]) failure = strcpy(msg, "path_hash: same hash for two distinct tours");
+  }
+  if (!failure && len != ntours) {
+    sprintf(msg, "path_canonical: %u canonical forms instead of %u", len, ntours);
+    failure = msg;
+  }
+  for (uint k = 0; k < len; k++) path_free(forms[k]);
+  free(forms);
+  free(hashes);
+  free(counts);
+  free(distmat);
+  return failure;
+}
+
+/* ************************************************************************** */
+
+/* smallest failing instance, by removing cities then by setting distances to 1, while some engine still fails */
+static instance *minimize(instance *in, char *msg) {
+  bool smaller = true;
+  while (smaller && in->size > 2) {
+    smaller = false;
+    for (uint city = 0; city < in->size && !smaller; city++) {
+      if (city == in->first) continue;
+      instance *out = instance_remove(in, city);
+      if (difftest(out, msg)) {
+        instance_free(in);
+        in = out;
+        smaller = true;
+      } else instance_free(out);
+    }
+  }
+  if (in->points) return in;
+  for (uint i = 0; i < in->size; i++)
+    for (uint j = 0; j < in->size; j++) {
+      uint ij = in->distmat[i * in->size + j], ji = in->distmat[j * in->size + i];
+      if (i == j || ij <= 1) continue;
+      in->distmat[i * in->size + j] = 1;
+      if (in->symmetric) in->distmat[j * in->size + i] = 1;
+      if (!difftest(in, msg)) {
+        in->distmat[i * in->size + j] = ij;
+        in->distmat[j * in->size + i] = ji;
+      }
+    }
+  difftest(in, msg);
+  return in;
+}
+
+/* ************************************************************************** */
+
+/* save an instance as a distance matrix, with a sidecar script running solve on it with its first city and
+ * objective, which the matrix format cannot hold */
+static void instance_save(instance *in, char *filename, char *msg) {
+  distmat_save(in->size, in->distmat, filename);
+  char *script = malloc(strlen(filename) + 4);
+  assert(script);
+  sprintf(script, "%s.sh", filename);
+  FILE *file = fopen(script, "w");
+  if (!file) {
+    fprintf(stderr, "Error: cannot write \"%s\"\n", script);
+    exit(EXIT_FAILURE);
+  }
+  fprintf(file, "# %s\n", msg);
+  fprintf(file, "./solve -l %s -f %u%s%s\n", filename, in->first, (in->options & BOTTLENECK) ? " -b" : "",
+          (in->options & OPENPATH) ? " -e" : "");
+  fclose(file);
+  printf("Saved in \"%s\", solved with the same first city and objective by \"%s\".\n", filename, script);
+  free(script);
+}
+
+/* ************************************************************************** */
+
+int main(int argc, char *argv[]) {
+  uint count = 100, maxsize = 9, seed = 1;
+  char *filename = "difftest.txt";
+  int c;
+  while ((c = getopt(argc, argv, "hn:m:s:o:")) != -1) {
+    if (c == 'n') count = atoi(optarg);
+    if (c == 'm') maxsize = atoi(optarg);
+    if (c == 's') seed = atoi(optarg);
+    if (c == 'o') filename = optarg;
+    if (c == 'h') usage(argc, argv);
+  }
+  if (optind != argc || maxsize < 2 || maxsize > MAXSIZE) usage(argc, argv);
+  rng_state = 0x9E3779B97F4A7C15ULL * seed | 1;
+
+  char msg[256];
+  if (difftest_canonical(CANONICAL_SIZE, msg)) {
+    printf("Tours of size %u failed: %s\n", CANONICAL_SIZE, msg);
+    return EXIT_FAILURE;
+  }
+  for (uint k = 0; k < count; k++) {
+    uint size = 2 + rng(maxsize - 1), structure = rng(NSTRUCTURES);
+    instance *in = instance_random(size, structure);
+    if (difftest(in, msg)) {
+      printf("Instance %u (%s, size %u, first %u, options %u) failed: %s\n", k, structures[structure], size,
+             in->first, in->options, msg);
+      in = minimize(in, msg);
+      printf("Minimized to size %u (first %u, options %u): %s\n", in->size, in->first, in->options, msg);
+      distmat_print(in->size, in->distmat);
+      instance_save(in, filename, msg);
+      instance_free(in);
+      return EXIT_FAILURE;
+    }
+    instance_free(in);
+  }
+  printf("%u instances: all exact engines agree, and canonical forms of tours of size %u.\n", count, CANONICAL_SIZE);
+  return EXIT_SUCCESS;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,157 @@
+/**
+ * @file elite.c
+ * @brief Elite pool: best distinct tours, shared by concurrent engines.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+/* ************************************************************************** */
+
+static void elite_lock(elite *e) {
+  while (__sync_lock_test_and_set(&e->lock, 1))
+    while (__atomic_load_n(&e->lock, __ATOMIC_RELAXED));
+}
+
+static void elite_unlock(elite *e) { __sync_lock_release(&e->lock); }
+
+/* ************************************************************************** */
+
+/* nb of edges of a tour also in the tour given by its neighbours (2 per city) */
+static uint elite_shared(path *p, uint *nbr, uint n) {
+  uint shared = 0;
+  for (uint i = 0; i < n; i++) {
+    uint a = p->array[i], b = p->array[i + 1];
+    if (nbr[2 * a] == b || nbr[2 * a + 1] == b) shared++;
+  }
+  return shared;
+}
+
+/* ************************************************************************** */
+
+elite *elite_new(TSP *tsp, uint capacity) {
+  assert(tsp);
+  assert(capacity >= 1);
+  elite *e = malloc(sizeof(elite));
+  assert(e);
+  e->tsp = tsp;
+  e->capacity = capacity;
+  e->len = 0;
+  e->tours = malloc(capacity * sizeof(path *));
+  e->hash = malloc(capacity * sizeof(unsigned long long));
+  assert(e->tours && e->hash);
+  e->worst = UINT_MAX;
+  e->lock = 0;
+  return e;
+}
+
+/* ************************************************************************** */
+
+void elite_free(elite *e) {
+  if (e) {
+    for (uint i = 0; i < e->len; i++) path_free(e->tours[i]);
+    free(e->tours);
+    free(e->hash);
+  }
+  free(e);
+}
+
+/* ************************************************************************** */
+
+bool elite_insert(elite *e, path *p) {
+  assert(e && p);
+  assert(tsp_check(e->tsp, p));
+  uint n = e->tsp->size;
+  if (p->dist >= __atomic_load_n(&e->worst, __ATOMIC_ACQUIRE)) return false; /* fast reject, without lock */
+
+  /* everything about the new tour is prepared before locking */
+  unsigned long long h = path_hash(p);
+  uint *nbr = malloc(2 * n * sizeof(uint));
+  assert(nbr);
+  for (uint i = 0; i < n; i++) {
+    nbr[2 * p->array[i]] = p->array[(i + n - 1) % n];
+    nbr[2 * p->array[i] + 1] = p->array[i + 1];
+  }
+  path *copy = path_new(n + 1, 0);
+  path_copy(p, copy);
+
+  elite_lock(e);
+  bool inserted = false;
+  int victim = -1; /* tour replaced: the most similar among the worse ones, or the worst */
+  uint maxshared = 0;
+  bool duplicate = false;
+  for (uint i = 0; i < e->len && !duplicate; i++) {
+    if (e->hash[i] == h && e->tours[i]->dist == p->dist && elite_shared(e->tours[i], nbr, n) == n) duplicate = true;
+    else if (e->len == e->capacity && e->tours[i]->dist > p->dist) {
+      uint shared = elite_shared(e->tours[i], nbr, n);
+      if (victim < 0 || shared >= maxshared) { /* ties: the worst */
+        victim = i;
+        maxshared = shared;
+      }
+    }
+  }
+  if (!duplicate && (e->len < e->capacity || victim >= 0)) {
+    if (victim >= 0) {
+      path_free(e->tours[victim]);
+      for (uint i = victim; i + 1 < e->len; i++) {
+        e->tours[i] = e->tours[i + 1];
+        e->hash[i] = e->hash[i + 1];
+      }
+      e->len--;
+    }
+    uint pos = e->len++; /* insertion sort, after the tours of the same distance */
+    while (pos > 0 && e->tours[pos - 1]->dist > copy->dist) {
+      e->tours[pos] = e->tours[pos - 1];
+      e->hash[pos] = e->hash[pos - 1];
+      pos--;
+    }
+    e->tours[pos] = copy;
+    e->hash[pos] = h;
+    inserted = true;
+    if (e->len == e->capacity) __atomic_store_n(&e->worst, e->tours[e->len - 1]->dist, __ATOMIC_RELEASE);
+  }
+  elite_unlock(e);
+
+  if (!inserted) path_free(copy);
+  free(nbr);
+  return inserted;
+}
+
+/* ************************************************************************** */
+
+uint elite_snapshot(elite *e, path **tours, uint max) {
+  assert(e && tours);
+  elite_lock(e);
+  uint len = (e->len < max) ? e->len : max;
+  for (uint i = 0; i < len; i++) {
+    tours[i] = path_new(e->tsp->size + 1, 0);
+    path_copy(e->tours[i], tours[i]);
+  }
+  elite_unlock(e);
+  return len;
+}
+
+/* ************************************************************************** */
+
+path *elite_best(elite *e) {
+  path *best = NULL;
+  return elite_snapshot(e, &best, 1) ? best : NULL;
+}
+
+/* ************************************************************************** */
+
+void tsp_set_elite(TSP *tsp, elite *e) {
+  assert(tsp);
+  assert(!e || e->tsp->size == tsp->size);
+  tsp->elite = e;
+}
+
+/* ************************************************************************** */
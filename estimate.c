@@ -0,0 +1,92 @@
+/**
+ * @file estimate.c
+ * @brief Estimate the size and run time of the exact search with random probes (Knuth).
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tsp_private.h"
+
+#define ESTIMATE_CALIBRATION (1ULL << 20) /* nb of nodes of the real search to measure its speed */
+
+/* ************************************************************************** */
+
+void tsp_estimate(TSP *tsp, uint probes, uint seed, estimate *est) {
+  assert(tsp && est);
+  assert(probes >= 2);
+  uint n = tsp->size;
+
+  /* the real search, silent and without checkpoint, for at most a few nodes to measure its speed */
+  TSP local = *tsp;
+  local.options &= ~(VERBOSE | DEBUG);
+  local.search = (search){0};
+  local.search.limit = ESTIMATE_CALIBRATION;
+  local.elite = NULL;
+  local.trace = NULL;
+  local.profile = NULL; /* neither the calibration run nor the bound are incumbents of the caller */
+  uint count = 0;
+  clock_t start = clock();
+  path *sol = tsp_solve(&local, &count);
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  double rate = seconds / local.search.nodes; /* seconds per node */
+  bool complete = !local.search.stopped;
+  path_free(sol);
+
+  /* the pruning bound is a heuristic tour (or the best one of the elite pool), as if found first */
+  path *bound = path_new(n + 1, UINT_MAX);
+  if (tsp->options & OPTIMIZE) {
+    path *tour = tsp->elite ? elite_best(tsp->elite) : NULL;
+    if (!tour) {
+      tour = tsp_nearest(&local);
+      bool sum = !(tsp->options & (BOTTLENECK | OPENPATH));
+      if (sum && tsp_symmetric(tsp)) tsp_2opt(&local, tour, NULL);
+    }
+    path_copy(tour, bound);
+    path_free(tour);
+  }
+
+  path *cur = path_new(n + 1, 0);
+  cur->array[cur->curlen++] = tsp->first;
+  uint *children = malloc(n * sizeof(uint));
+  assert(children);
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ seed;
+  double sum = 0.0, sum2 = 0.0, leaves = 0.0;
+  for (uint i = 0; i < probes; i++) {
+    double nodes = search_probe(tsp, cur, bound, children, &state, &leaves);
+    sum += nodes;
+    sum2 += nodes * nodes;
+  }
+  double mean = sum / probes;
+  double var = (sum2 - probes * mean * mean) / (probes - 1);
+  double half = 1.96 * sqrt(var > 0 ? var : 0) / sqrt(probes); /* 95% confidence interval */
+
+  if (complete) { /* the calibration run was the whole search */
+    est->nodes = est->nodes_low = est->nodes_high = local.search.nodes;
+    est->seconds = est->seconds_low = est->seconds_high = seconds;
+    est->paths = count;
+  } else {
+    est->nodes = mean;
+    est->nodes_low = (mean - half > 1.0) ? mean - half : 1.0;
+    est->nodes_high = mean + half;
+    est->seconds = est->nodes * rate;
+    est->seconds_low = est->nodes_low * rate;
+    est->seconds_high = est->nodes_high * rate;
+    est->paths = leaves / probes;
+  }
+  est->rate = 1.0 / rate;
+
+  free(children);
+  path_free(cur);
+  path_free(bound);
+}
+
+/* ************************************************************************** */
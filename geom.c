@@ -0,0 +1,205 @@
+/**
+ * @file geom.c
+ * @brief Geometric instances: city coordinates and kd-tree.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <float.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+/* ************************************************************************** */
+/*                                 POINTS                                     */
+/* ************************************************************************** */
+
+double *points_random(uint size, uint seed, uint max) {
+  assert(size > 0 && max > 0);
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ seed; /* not libc rand, whose sequence is platform-specific */
+  double *points = malloc(2 * size * sizeof(double));
+  assert(points);
+  for (uint i = 0; i < 2 * size; i++) points[i] = rng_next(&state) / 4294967296.0 * max;
+  return points;
+}
+
+/* ************************************************************************** */
+
+double *points_load(char *filename, uint *size) {
+  assert(filename);
+  assert(size);
+  FILE *file = fopen(filename, "r");
+  if (!file) file_fail(filename, "cannot read city coordinates");
+  if (fscanf(file, "%u", size) != 1 || *size == 0) file_fail(filename, "bad size of city coordinates");
+  double *points = malloc(2 * *size * sizeof(double));
+  assert(points);
+  for (uint i = 0; i < 2 * *size; i++)
+    if (fscanf(file, "%lf", &points[i]) != 1) file_fail(filename, "truncated city coordinates");
+  fclose(file);
+  return points;
+}
+
+/* ************************************************************************** */
+
+void points_save(uint size, double *points, char *filename) {
+  assert(filename);
+  assert(points);
+  FILE *file = fopen(filename, "w");
+  assert(file);
+  fprintf(file, "%u\n", size);
+  for (uint i = 0; i < size; i++) fprintf(file, "%.6f %.6f\n", points[2 * i], points[2 * i + 1]);
+  fclose(file);
+}
+
+void points_summary(uint size, double *points) {
+  assert(points);
+  double min[2] = {DBL_MAX, DBL_MAX}, max[2] = {-DBL_MAX, -DBL_MAX};
+  unsigned long long h = 0xCBF29CE484222325ULL; /* FNV-1a, on coordinates rounded to 1e-6 */
+  for (uint i = 0; i < 2 * size; i++) {
+    double x = points[i];
+    if (x < min[i % 2]) min[i % 2] = x;
+    if (x > max[i % 2]) max[i % 2] = x;
+    h ^= (unsigned long long)llround(x * 1e6);
+    h *= 0x100000001B3ULL;
+  }
+  printf("City coordinates of size %u: x in [%.2f,%.2f], y in [%.2f,%.2f], hash %016llx\n", size, min[0], max[0],
+         min[1], max[1], h);
+}
+
+/* ************************************************************************** */
+/*                                 KD-TREE                                    */
+/* ************************************************************************** */
+
+/* partially sort perm[lo..hi-1] along dim, such that perm[mid] is the median */
+static void kdtree_select(double *points, uint *perm, int lo, int hi, int mid, uint dim) {
+  while (hi - lo > 1) {
+    double pivot = points[2 * perm[(lo + hi) / 2] + dim];
+    int i = lo, j = hi - 1;
+    while (i <= j) {
+      while (points[2 * perm[i] + dim] < pivot) i++;
+      while (points[2 * perm[j] + dim] > pivot) j--;
+      if (i <= j) {
+        uint tmp = perm[i];
+        perm[i++] = perm[j];
+        perm[j--] = tmp;
+      }
+    }
+    if (mid <= j) hi = j + 1;
+    else if (mid >= i) lo = i;
+    else return;
+  }
+}
+
+/* ************************************************************************** */
+
+static int kdtree_build(kdtree *kd, uint lo, uint hi, uint bucket) {
+  int id = kd->nnodes++;
+  kdnode *node = &kd->nodes[id];
+  node->lo = lo;
+  node->hi = hi;
+  node->left = node->right = -1;
+  if (hi - lo <= bucket) return id;
+
+  /* split the largest extent at median */
+  double min[2] = {DBL_MAX, DBL_MAX}, max[2] = {-DBL_MAX, -DBL_MAX};
+  for (uint i = lo; i < hi; i++)
+    for (uint d = 0; d < 2; d++) {
+      double x = kd->points[2 * kd->perm[i] + d];
+      if (x < min[d]) min[d] = x;
+      if (x > max[d]) max[d] = x;
+    }
+  uint dim = (max[1] - min[1] > max[0] - min[0]) ? 1 : 0;
+  uint mid = (lo + hi) / 2;
+  kdtree_select(kd->points, kd->perm, lo, hi, mid, dim);
+  node->dim = dim;
+  node->cut = kd->points[2 * kd->perm[mid] + dim];
+  int left = kdtree_build(kd, lo, mid, bucket);
+  int right = kdtree_build(kd, mid, hi, bucket);
+  node = &kd->nodes[id];
+  node->left = left;
+  node->right = right;
+  return id;
+}
+
+/* ************************************************************************** */
+
+kdtree *kdtree_new(uint size, double *points, uint bucket) {
+  assert(size > 0 && points);
+  assert(bucket > 0);
+  kdtree *kd = malloc(sizeof(kdtree));
+  assert(kd);
+  kd->size = size;
+  kd->points = points;
+  kd->perm = malloc(size * sizeof(uint));
+  assert(kd->perm);
+  for (uint i = 0; i < size; i++) kd->perm[i] = i;
+  uint maxnodes = 4 * (size / bucket + 1); /* leaves hold at least bucket/2 cities */
+  kd->nodes = malloc(maxnodes * sizeof(kdnode));
+  assert(kd->nodes);
+  kd->nnodes = 0;
+  kdtree_build(kd, 0, size, bucket);
+  return kd;
+}
+
+/* ************************************************************************** */
+
+void kdtree_free(kdtree *kd) {
+  if (kd) {
+    free(kd->perm);
+    free(kd->nodes);
+  }
+  free(kd);
+}
+
+/* ************************************************************************** */
+
+typedef struct knn {
+  uint k, len;  /* max and current nb of neighbours */
+  uint *nbr;    /* neighbours sorted by increasing distance */
+  double *dist; /* squared distances */
+} knn;
+
+static void kdtree_knn_rec(kdtree *kd, int id, uint city, knn *res) {
+  kdnode *node = &kd->nodes[id];
+  double *p = &kd->points[2 * city];
+  if (node->left < 0) {
+    for (uint i = node->lo; i < node->hi; i++) {
+      uint other = kd->perm[i];
+      if (other == city) continue;
+      double dx = kd->points[2 * other] - p[0], dy = kd->points[2 * other + 1] - p[1];
+      double d = dx * dx + dy * dy;
+      if (res->len == res->k && d >= res->dist[res->len - 1]) continue;
+      uint j = (res->len < res->k) ? res->len++ : res->len - 1; /* insertion sort */
+      while (j > 0 && res->dist[j - 1] > d) {
+        res->nbr[j] = res->nbr[j - 1];
+        res->dist[j] = res->dist[j - 1];
+        j--;
+      }
+      res->nbr[j] = other;
+      res->dist[j] = d;
+    }
+    return;
+  }
+  double delta = p[node->dim] - node->cut;
+  int near = (delta < 0) ? node->left : node->right;
+  int far = (delta < 0) ? node->right : node->left;
+  kdtree_knn_rec(kd, near, city, res);
+  if (res->len < res->k || delta * delta < res->dist[res->len - 1]) kdtree_knn_rec(kd, far, city, res);
+}
+
+/* ************************************************************************** */
+
+void kdtree_knn(kdtree *kd, uint city, uint k, uint *nbr) {
+  assert(kd && nbr);
+  assert(k < kd->size);
+  double dist[k];
+  knn res = {k, 0, nbr, dist};
+  kdtree_knn_rec(kd, 0, city, &res);
+  assert(res.len == k);
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,229 @@
+/**
+ * @file gls.c
+ * @brief Guided local search: 2-opt on distances augmented by penalties of the edges of past local optima.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define GLS_ALPHA 0.3 /* penalty weight, relative to the mean edge of the first local optimum */
+#define GLS_INIT 1024 /* initial nb of slots of the penalty table (power of 2) */
+
+/* ************************************************************************** */
+/*                                 PENALTIES                                  */
+/* ************************************************************************** */
+
+/* sparse penalties of edges, only those ever penalized, in an open addressing table */
+typedef struct penalty {
+  uint *count;              /* nb of penalized edges of each city, to skip the table for most edges */
+  unsigned long long *keys; /* edge (i,j) with i < j as i*2^32+j+1, or 0 for an empty slot */
+  uint *vals;               /* penalty of each edge */
+  uint cap;                 /* nb of slots (power of 2) */
+  uint len;                 /* nb of penalized edges */
+} penalty;
+
+static inline unsigned long long pen_key(uint i, uint j) {
+  return (i < j) ? (((unsigned long long)i << 32) | j) + 1 : (((unsigned long long)j << 32) | i) + 1;
+}
+
+static inline uint pen_slot(penalty *P, unsigned long long key) {
+  uint mask = P->cap - 1;
+  uint slot = (key * 0x9E3779B97F4A7C15ULL) >> 32 & mask;
+  while (P->keys[slot] != 0 && P->keys[slot] != key) slot = (slot + 1) & mask;
+  return slot;
+}
+
+/* ************************************************************************** */
+
+static inline uint pen_get(penalty *P, uint i, uint j) {
+  if (P->count[i] == 0 || P->count[j] == 0) return 0; /* no table lookup for most edges */
+  uint slot = pen_slot(P, pen_key(i, j));
+  return P->keys[slot] ? P->vals[slot] : 0;
+}
+
+/* ************************************************************************** */
+
+static void pen_inc(penalty *P, uint i, uint j) {
+  unsigned long long key = pen_key(i, j);
+  uint slot = pen_slot(P, key);
+  if (P->keys[slot]) {
+    P->vals[slot]++;
+    return;
+  }
+  P->keys[slot] = key;
+  P->vals[slot] = 1;
+  P->count[i]++;
+  P->count[j]++;
+  if (2 * ++P->len <= P->cap) return;
+  /* load factor at most 1/2 */
+  uint cap = P->cap;
+  unsigned long long *keys = P->keys;
+  uint *vals = P->vals;
+  P->cap = 2 * cap;
+  P->keys = calloc(P->cap, sizeof(unsigned long long));
+  P->vals = malloc(P->cap * sizeof(uint));
+  assert(P->keys && P->vals);
+  for (uint s = 0; s < cap; s++)
+    if (keys[s]) {
+      uint t = pen_slot(P, keys[s]);
+      P->keys[t] = keys[s];
+      P->vals[t] = vals[s];
+    }
+  free(keys);
+  free(vals);
+}
+
+/* ************************************************************************** */
+/*                                LOCAL SEARCH                                */
+/* ************************************************************************** */
+
+typedef struct gls {
+  TSP *tsp;
+  cand *c;
+  penalty P;
+  double lambda; /* weight of penalties in augmented distances */
+  uint *cycle;   /* current tour */
+  uint *pos;     /* position of each city in the tour */
+  uint *fifo;    /* circular queue of active cities */
+  bool *active;
+  uint head, len;
+  long long dist; /* real distance of the current tour */
+} gls;
+
+static inline double gls_cost(gls *g, uint i, uint j) {
+  return tsp_dist(g->tsp, i, j) + g->lambda * pen_get(&g->P, i, j);
+}
+
+static void gls_push(gls *g, uint city) {
+  if (g->active[city]) return;
+  g->active[city] = true;
+  g->fifo[(g->head + g->len++) % g->tsp->size] = city;
+}
+
+/* ************************************************************************** */
+
+/* 2-opt on augmented distances, from the active cities, keeping track of the real distance */
+static void gls_2opt(gls *g) {
+  TSP *tsp = g->tsp;
+  uint n = tsp->size;
+  uint *cycle = g->cycle, *pos = g->pos;
+  while (g->len > 0) {
+    uint a = g->fifo[g->head];
+    g->head = (g->head + 1) % n;
+    g->len--;
+    g->active[a] = false;
+    bool improved = false;
+    for (uint dir = 0; dir < 2 && !improved; dir++) {
+      uint b = (dir == 0) ? cycle[(pos[a] + 1) % n] : cycle[(pos[a] + n - 1) % n];
+      double hab = gls_cost(g, a, b);
+      for (uint k = g->c->start[a]; k < g->c->start[a + 1]; k++) {
+        uint city = g->c->adj[k];
+        double hac = gls_cost(g, a, city);
+        if (hac >= hab) continue; /* lists are sorted by real distance only */
+        uint d = (dir == 0) ? cycle[(pos[city] + 1) % n] : cycle[(pos[city] + n - 1) % n];
+        if (city == b || d == a) continue;
+        double gain = hab + gls_cost(g, city, d) - hac - gls_cost(g, b, d);
+        if (gain <= 1e-9) continue;
+        g->dist += (long long)tsp_dist(tsp, a, city) + tsp_dist(tsp, b, d) - tsp_dist(tsp, a, b) - tsp_dist(tsp, city, d);
+        if (dir == 0) ls_reverse(cycle, pos, n, pos[b], pos[city]);
+        else ls_reverse(cycle, pos, n, pos[a], pos[d]);
+        uint touched[4] = {a, b, city, d};
+        for (uint t = 0; t < 4; t++) gls_push(g, touched[t]);
+        improved = true;
+        break;
+      }
+    }
+  }
+}
+
+/* ************************************************************************** */
+
+/* penalize the tour edges of max utility d/(1+p), and activate their cities */
+static void gls_penalize(gls *g) {
+  TSP *tsp = g->tsp;
+  uint n = tsp->size;
+  double best = -1.0;
+  for (uint i = 0; i < n; i++) {
+    uint a = g->cycle[i], b = g->cycle[(i + 1) % n];
+    double util = tsp_dist(tsp, a, b) / (1.0 + pen_get(&g->P, a, b));
+    if (util > best) best = util;
+  }
+  for (uint i = 0; i < n; i++) {
+    uint a = g->cycle[i], b = g->cycle[(i + 1) % n];
+    if (tsp_dist(tsp, a, b) / (1.0 + pen_get(&g->P, a, b)) < best) continue;
+    pen_inc(&g->P, a, b);
+    gls_push(g, a);
+    gls_push(g, b);
+  }
+}
+
+/* ************************************************************************** */
+
+void tsp_gls(TSP *tsp, path *p, cand *c, uint iterations) {
+  assert(tsp && p);
+  assert(p->curlen == tsp->size + 1);
+  uint n = tsp->size;
+  if (n < 4) return;
+  if (!c) c = tsp->cand;
+  cand *own = c ? NULL : cand_knn(tsp, 8);
+
+  gls g = {tsp, c ? c : own};
+  g.P.cap = GLS_INIT;
+  g.P.count = calloc(n, sizeof(uint));
+  g.P.keys = calloc(GLS_INIT, sizeof(unsigned long long));
+  g.P.vals = malloc(GLS_INIT * sizeof(uint));
+  g.cycle = malloc(n * sizeof(uint));
+  g.pos = malloc(n * sizeof(uint));
+  g.fifo = malloc(n * sizeof(uint));
+  g.active = calloc(n, sizeof(bool));
+  uint *best = malloc(n * sizeof(uint));
+  assert(g.P.count && g.P.keys && g.P.vals && g.cycle && g.pos && g.fifo && g.active && best);
+  for (uint i = 0; i < n; i++) {
+    g.cycle[i] = p->array[i];
+    g.pos[p->array[i]] = i;
+    gls_push(&g, p->array[i]);
+  }
+  g.dist = 0;
+  for (uint i = 0; i < n; i++) g.dist += tsp_dist(tsp, g.cycle[i], g.cycle[(i + 1) % n]);
+
+  /* first local optimum, without penalties */
+  gls_2opt(&g);
+  long long bestdist = g.dist;
+  for (uint i = 0; i < n; i++) best[i] = g.cycle[i];
+  g.lambda = GLS_ALPHA * g.dist / n;
+
+  for (uint it = 0; it < iterations; it++) {
+    gls_penalize(&g);
+    gls_2opt(&g);
+    if (g.dist < bestdist) {
+      bestdist = g.dist;
+      for (uint i = 0; i < n; i++) best[i] = g.cycle[i];
+      if (tsp->profile) profile_record(tsp->profile, bestdist);
+    }
+  }
+
+  for (uint i = 0; i < n; i++) p->array[i] = best[i];
+  path_rotate(tsp, p);
+  assert(p->dist == bestdist);
+  if (tsp->elite) elite_insert(tsp->elite, p);
+  if (tsp->profile) profile_record(tsp->profile, p->dist);
+
+  free(best);
+  free(g.active);
+  free(g.fifo);
+  free(g.pos);
+  free(g.cycle);
+  free(g.P.vals);
+  free(g.P.keys);
+  free(g.P.count);
+  cand_free(own);
+}
+
+/* ************************************************************************** */
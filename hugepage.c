@@ -0,0 +1,187 @@
+/**
+ * @file hugepage.c
+ * @brief Allocation of large buffers on huge pages: transparent (madvise) or explicit (MAP_HUGETLB), with
+ * fallback to normal pages.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#define _GNU_SOURCE /* madvise, MAP_ANONYMOUS, MAP_HUGETLB */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "tsp_private.h"
+
+#define HUGE_DEFAULT (2UL << 20) /* huge page size if not found in /proc/meminfo */
+#define HUGE_LINE 256            /* max length of a line of /proc files */
+
+/* ************************************************************************** */
+
+typedef struct mapping {
+  void *addr; /* explicit huge page mapping */
+  size_t len; /* its length, rounded to huge pages */
+} mapping;
+
+static struct {
+  uint mode;                   /* HUGE_OFF, HUGE_TRANSPARENT or HUGE_EXPLICIT */
+  size_t hugesize;             /* huge page size (0 until read) */
+  mapping *maps;               /* live explicit mappings, to be unmapped rather than freed */
+  uint nmaps, cap;             /* nb of mappings, and their capacity */
+  unsigned long long advised;  /* bytes advised for transparent huge pages */
+  unsigned long long mapped;   /* bytes mapped on explicit huge pages */
+  unsigned long long fallback; /* bytes of failed explicit mappings, advised instead */
+  char lock;                   /* spinlock on mappings and counters */
+} huge = {HUGE_TRANSPARENT, 0, NULL, 0, 0, 0, 0, 0, 0};
+
+static void huge_lock(void) {
+  while (__sync_lock_test_and_set(&huge.lock, 1))
+    while (__atomic_load_n(&huge.lock, __ATOMIC_RELAXED));
+}
+
+static void huge_unlock(void) { __sync_lock_release(&huge.lock); }
+
+/* ************************************************************************** */
+
+/* value in kB of a "Key: value kB" line of a /proc file, or 0 if not found */
+static unsigned long long huge_proc(char *filename, char *key) {
+  FILE *file = fopen(filename, "r");
+  if (!file) return 0;
+  char line[HUGE_LINE];
+  size_t keylen = strlen(key);
+  unsigned long long kb = 0;
+  while (fgets(line, HUGE_LINE, file))
+    if (strncmp(line, key, keylen) == 0 && line[keylen] == ':') {
+      kb = strtoull(line + keylen + 1, NULL, 10);
+      break;
+    }
+  fclose(file);
+  return kb;
+}
+
+/* huge page size, read once (concurrent first reads store the same value) */
+static size_t huge_pagesize(void) {
+  size_t hugesize = __atomic_load_n(&huge.hugesize, __ATOMIC_RELAXED);
+  if (hugesize == 0) {
+    unsigned long long kb = huge_proc("/proc/meminfo", "Hugepagesize");
+    hugesize = kb > 0 ? kb << 10 : HUGE_DEFAULT;
+    __atomic_store_n(&huge.hugesize, hugesize, __ATOMIC_RELAXED);
+  }
+  return hugesize;
+}
+
+/* ************************************************************************** */
+
+void *huge_alloc(size_t bytes, bool zero) {
+  size_t hugesize = __atomic_load_n(&huge.mode, __ATOMIC_RELAXED) != HUGE_OFF ? huge_pagesize() : 0;
+  if (hugesize == 0 || bytes < hugesize) {
+    void *ptr = zero ? calloc(bytes, 1) : malloc(bytes);
+    assert(ptr);
+    return ptr;
+  }
+  /* aligned on a huge page, so that the kernel can back whole huge pages, and advised before first touch */
+  void *ptr = NULL;
+  if (posix_memalign(&ptr, hugesize, bytes) != 0) ptr = malloc(bytes); /* normal pages */
+  assert(ptr);
+#ifdef MADV_HUGEPAGE
+  if (madvise(ptr, (bytes / hugesize) * hugesize, MADV_HUGEPAGE) == 0) {
+    huge_lock();
+    huge.advised += bytes;
+    huge_unlock();
+  }
+#endif
+  if (zero) memset(ptr, 0, bytes);
+  return ptr;
+}
+
+/* ************************************************************************** */
+
+void *huge_map(size_t bytes) {
+  if (__atomic_load_n(&huge.mode, __ATOMIC_RELAXED) != HUGE_EXPLICIT || bytes < huge_pagesize())
+    return huge_alloc(bytes, true);
+#ifdef MAP_HUGETLB
+  size_t hugesize = huge_pagesize();
+  size_t len = (bytes + hugesize - 1) / hugesize * hugesize;
+  void *addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (addr != MAP_FAILED) {
+    huge_lock();
+    if (huge.nmaps == huge.cap) {
+      huge.cap = huge.cap ? 2 * huge.cap : 16;
+      huge.maps = realloc(huge.maps, huge.cap * sizeof(mapping));
+      assert(huge.maps);
+    }
+    huge.maps[huge.nmaps++] = (mapping){addr, len};
+    huge.mapped += len;
+    huge_unlock();
+    return addr; /* zeroed by the kernel */
+  }
+#endif
+  /* no huge page reserved (or left) in the pool */
+  huge_lock();
+  huge.fallback += bytes;
+  huge_unlock();
+  return huge_alloc(bytes, true);
+}
+
+/* ************************************************************************** */
+
+void huge_free(void *ptr) {
+  if (!ptr) return;
+  if (__atomic_load_n(&huge.nmaps, __ATOMIC_ACQUIRE) > 0) {
+    huge_lock();
+    for (uint i = 0; i < huge.nmaps; i++)
+      if (huge.maps[i].addr == ptr) {
+        mapping m = huge.maps[i];
+        huge.maps[i] = huge.maps[--huge.nmaps];
+        huge_unlock();
+        munmap(m.addr, m.len);
+        return;
+      }
+    huge_unlock();
+  }
+  free(ptr);
+}
+
+/* ************************************************************************** */
+
+void huge_set_mode(uint mode) {
+  assert(mode == HUGE_OFF || mode == HUGE_TRANSPARENT || mode == HUGE_EXPLICIT);
+  __atomic_store_n(&huge.mode, mode, __ATOMIC_RELAXED);
+}
+
+/* ************************************************************************** */
+
+void huge_stats(pagestats *st) {
+  assert(st);
+  st->mode = __atomic_load_n(&huge.mode, __ATOMIC_RELAXED);
+  st->pagesize = (size_t)sysconf(_SC_PAGESIZE);
+  st->hugesize = huge_pagesize();
+  huge_lock();
+  st->advised = huge.advised;
+  st->mapped = huge.mapped;
+  st->fallback = huge.fallback;
+  huge_unlock();
+  /* transparent huge pages actually backing the process, as the kernel may ignore or delay the advice */
+  st->backed = huge_proc("/proc/self/smaps_rollup", "AnonHugePages") << 10;
+}
+
+/* ************************************************************************** */
+
+void huge_summary(void) {
+  static char *modes[] = {"off", "transparent", "explicit"};
+  pagestats st;
+  huge_stats(&st);
+  double mib = 1024.0 * 1024.0;
+  printf("Pages of %zu KiB, huge pages of %zu KiB (%s): %.1f MiB advised, %.1f MiB backed, %.1f MiB explicit",
+         st.pagesize >> 10, st.hugesize >> 10, modes[st.mode], st.advised / mib, st.backed / mib, st.mapped / mib);
+  if (st.fallback > 0) printf(", %.1f MiB fallen back to transparent", st.fallback / mib);
+  printf(".\n");
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,141 @@
+/**
+ * @file iter.c
+ * @brief Pull-based enumeration of all tours, with an explicit stack, and its binary sink.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define ITER_MAGIC "TSPTOUR1"
+#define ITER_BUFSIZE (1 << 20) /* sink buffer size in bytes */
+
+/* ************************************************************************** */
+
+struct tsp_iter {
+  TSP *tsp;
+  path *cur;  /* current path, cur->array[d] placed at depth d */
+  uint *next; /* next city to try at each depth */
+  uint *dist; /* distance of the path of each length */
+  bool *used; /* cities in the current path */
+};
+
+/* ************************************************************************** */
+
+static inline uint iter_agg(TSP *tsp, uint acc, uint d) {
+  if (tsp->options & BOTTLENECK) return (d > acc) ? d : acc;
+  return acc + d;
+}
+
+/* ************************************************************************** */
+
+tsp_iter *tsp_iter_new(TSP *tsp) {
+  assert(tsp);
+  uint n = tsp->size;
+  tsp_iter *it = malloc(sizeof(tsp_iter));
+  assert(it);
+  it->tsp = tsp;
+  it->cur = path_new(n + 1, 0);
+  it->next = calloc(n + 1, sizeof(uint));
+  it->dist = calloc(n + 1, sizeof(uint));
+  it->used = calloc(n, sizeof(bool));
+  assert(it->next && it->dist && it->used);
+  it->cur->array[it->cur->curlen++] = tsp->first;
+  it->used[tsp->first] = true;
+  return it;
+}
+
+/* ************************************************************************** */
+
+void tsp_iter_free(tsp_iter *it) {
+  if (it) {
+    path_free(it->cur);
+    free(it->next);
+    free(it->dist);
+    free(it->used);
+  }
+  free(it);
+}
+
+/* ************************************************************************** */
+
+bool tsp_iter_next(tsp_iter *it, path *out) {
+  assert(it && out);
+  TSP *tsp = it->tsp;
+  uint n = tsp->size;
+  path *cur = it->cur;
+  assert(out->maxlen >= n + 1);
+  while (cur->curlen > 0) {
+    uint d = cur->curlen;
+    if (d == n || it->next[d] == n) { /* tour already returned, or all cities tried: backtrack */
+      it->used[cur->array[--cur->curlen]] = false;
+      continue;
+    }
+    uint city = it->next[d]++;
+    if (it->used[city] || tsp_dist(tsp, cur->array[d - 1], city) == DIST_INF) continue; /* missing arc */
+    it->used[city] = true;
+    cur->array[cur->curlen++] = city;
+    it->dist[d + 1] = iter_agg(tsp, it->dist[d], tsp_dist(tsp, cur->array[d - 1], city));
+    it->next[d + 1] = 0;
+    if (cur->curlen < n) continue;
+
+    /* complete path, as returned by the exact search */
+    if (!(tsp->options & OPENPATH) && tsp_dist(tsp, city, tsp->first) == DIST_INF) continue;
+    for (uint i = 0; i < n; i++) out->array[i] = cur->array[i];
+    out->curlen = n;
+    out->dist = it->dist[n];
+    if (!(tsp->options & OPENPATH)) {
+      out->array[out->curlen++] = tsp->first;
+      out->dist = iter_agg(tsp, out->dist, tsp_dist(tsp, city, tsp->first));
+    }
+    return true;
+  }
+  return false;
+}
+
+/* ************************************************************************** */
+
+unsigned long long tsp_iter_save(TSP *tsp, char *filename) {
+  assert(tsp && filename);
+  uint n = tsp->size;
+  assert(n <= 65536);
+  FILE *file = fopen(filename, "wb");
+  if (!file) file_fail(filename, "cannot write tours");
+  char *buf = malloc(ITER_BUFSIZE);
+  assert(buf);
+  setvbuf(file, buf, _IOFBF, ITER_BUFSIZE);
+
+  /* header: magic, nb of cities per record; records: distance (32 bits), cities (16 bits each) */
+  uint len = (tsp->options & OPENPATH) ? n : n + 1;
+  if (fwrite(ITER_MAGIC, 1, 8, file) != 8 || fwrite(&len, sizeof(uint), 1, file) != 1)
+    file_fail(filename, "cannot write tours");
+  size_t recsize = sizeof(uint) + len * sizeof(unsigned short);
+  unsigned char *rec = malloc(recsize);
+  assert(rec);
+  unsigned short *cities = (unsigned short *)(rec + sizeof(uint));
+
+  tsp_iter *it = tsp_iter_new(tsp);
+  path *p = path_new(n + 1, 0);
+  unsigned long long count = 0;
+  while (tsp_iter_next(it, p)) {
+    *(uint *)rec = p->dist;
+    for (uint i = 0; i < len; i++) cities[i] = p->array[i];
+    if (fwrite(rec, recsize, 1, file) != 1) file_fail(filename, "cannot write tours");
+    count++;
+  }
+
+  path_free(p);
+  tsp_iter_free(it);
+  free(rec);
+  if (fclose(file) != 0) file_fail(filename, "cannot write tours");
+  free(buf);
+  return count;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,177 @@
+/**
+ * @file karp.c
+ * @brief Karp-style spatial partitioning: solve small cells, stitch them and clean up the joins.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define KARP_EXACT 9 /* max cell size solved with the exact engine */
+#define KARP_JOIN 8  /* nb of cities close to the split line considered for a join */
+
+/* ************************************************************************** */
+
+typedef struct karp {
+  TSP *tsp;
+  kdtree *kd;
+  uint **tours;  /* cell tours (or merged tours), indexed by kd-tree node */
+  uint *lens;    /* tour lengths, indexed by kd-tree node */
+  uint *joins;   /* cities at both ends of the stitching edges */
+  uint njoins;   /* nb of join cities */
+} karp;
+
+/* ************************************************************************** */
+
+/* solve a cell of k cities on its own k*k distance matrix, and return its cycle */
+static uint *karp_cell(TSP *tsp, uint *cities, uint k) {
+  uint *cycle = malloc(k * sizeof(uint));
+  assert(cycle);
+  if (k <= 3) {
+    for (uint i = 0; i < k; i++) cycle[i] = cities[i];
+    return cycle;
+  }
+  uint *distmat = malloc(k * k * sizeof(uint));
+  assert(distmat);
+  for (uint i = 0; i < k; i++)
+    for (uint j = 0; j < k; j++) distmat[i * k + j] = tsp_dist(tsp, cities[i], cities[j]);
+  TSP *sub = tsp_new(k, 0, distmat, OPTIMIZE);
+  path *sol;
+  if (k <= KARP_EXACT) {
+    sol = tsp_solve(sub, NULL);
+  } else {
+    sol = tsp_nearest(sub);
+    tsp_2opt(sub, sol, NULL);
+  }
+  for (uint i = 0; i < k; i++) cycle[i] = cities[sol->array[i]];
+  path_free(sol);
+  tsp_free(sub);
+  free(distmat);
+  return cycle;
+}
+
+/* ************************************************************************** */
+
+/* select up to KARP_JOIN positions of the cycle closest to the cut line */
+static uint karp_border(karp *kp, uint *cycle, uint len, kdnode *node, uint *border) {
+  double key[KARP_JOIN];
+  uint nb = 0;
+  for (uint i = 0; i < len; i++) {
+    double x = kp->tsp->points[2 * cycle[i] + node->dim] - node->cut;
+    if (x < 0) x = -x;
+    if (nb == KARP_JOIN && x >= key[nb - 1]) continue;
+    uint j = (nb < KARP_JOIN) ? nb++ : nb - 1;
+    while (j > 0 && key[j - 1] > x) {
+      key[j] = key[j - 1];
+      border[j] = border[j - 1];
+      j--;
+    }
+    key[j] = x;
+    border[j] = i;
+  }
+  return nb;
+}
+
+/* ************************************************************************** */
+
+/* merge the cycles of both children of a node with the cheapest 2-edge exchange across the cut */
+static void karp_merge(karp *kp, int id) {
+  kdnode *node = &kp->kd->nodes[id];
+  if (node->left < 0) return;
+  karp_merge(kp, node->left);
+  karp_merge(kp, node->right);
+  TSP *tsp = kp->tsp;
+  uint *L = kp->tours[node->left], nl = kp->lens[node->left];
+  uint *R = kp->tours[node->right], nr = kp->lens[node->right];
+
+  uint bl[KARP_JOIN], br[KARP_JOIN];
+  uint nbl = karp_border(kp, L, nl, node, bl);
+  uint nbr = karp_border(kp, R, nr, node, br);
+
+  /* remove edges (L[i],L[i+1]) and (R[j],R[j+1]), try both ways to reconnect */
+  long long best = LLONG_MAX;
+  uint bi = 0, bj = 0, bway = 0;
+  for (uint x = 0; x < nbl; x++)
+    for (uint sl = 0; sl < 2; sl++) {
+      uint i = (bl[x] + nl - sl) % nl;
+      uint a = L[i], a2 = L[(i + 1) % nl];
+      for (uint y = 0; y < nbr; y++)
+        for (uint sr = 0; sr < 2; sr++) {
+          uint j = (br[y] + nr - sr) % nr;
+          uint b = R[j], b2 = R[(j + 1) % nr];
+          long long removed = (long long)tsp_dist(tsp, a, a2) + tsp_dist(tsp, b, b2);
+          long long way0 = (long long)tsp_dist(tsp, a, b) + tsp_dist(tsp, b2, a2) - removed;
+          long long way1 = (long long)tsp_dist(tsp, a, b2) + tsp_dist(tsp, b, a2) - removed;
+          if (way0 < best) best = way0, bi = i, bj = j, bway = 0;
+          if (way1 < best) best = way1, bi = i, bj = j, bway = 1;
+        }
+    }
+
+  /* L from L[bi+1] around to L[bi], then R backward from R[bj] (way 0) or forward from R[bj+1] (way 1) */
+  uint *merged = malloc((nl + nr) * sizeof(uint));
+  assert(merged);
+  for (uint t = 0; t < nl; t++) merged[t] = L[(bi + 1 + t) % nl];
+  for (uint t = 0; t < nr; t++) merged[nl + t] = (bway == 0) ? R[(bj + nr - t) % nr] : R[(bj + 1 + t) % nr];
+  kp->joins[kp->njoins++] = L[bi];
+  kp->joins[kp->njoins++] = L[(bi + 1) % nl];
+  kp->joins[kp->njoins++] = R[bj];
+  kp->joins[kp->njoins++] = R[(bj + 1) % nr];
+
+  free(L);
+  free(R);
+  kp->tours[node->left] = kp->tours[node->right] = NULL;
+  kp->tours[id] = merged;
+  kp->lens[id] = nl + nr;
+}
+
+/* ************************************************************************** */
+
+path *tsp_solve_karp(TSP *tsp, uint cellmax) {
+  assert(tsp && tsp->points);
+  assert(cellmax >= 1);
+  karp kp;
+  kp.tsp = tsp;
+  kp.kd = kdtree_new(tsp->size, tsp->points, cellmax);
+  kp.tours = calloc(kp.kd->nnodes, sizeof(uint *));
+  kp.lens = calloc(kp.kd->nnodes, sizeof(uint));
+  kp.joins = malloc(4 * kp.kd->nnodes * sizeof(uint));
+  kp.njoins = 0;
+  assert(kp.tours && kp.lens && kp.joins);
+
+  /* solve all cells independently */
+  int nnodes = kp.kd->nnodes;
+#pragma omp parallel for schedule(dynamic)
+  for (int id = 0; id < nnodes; id++) {
+    kdnode *node = &kp.kd->nodes[id];
+    if (node->left >= 0) continue;
+    kp.tours[id] = karp_cell(tsp, &kp.kd->perm[node->lo], node->hi - node->lo);
+    kp.lens[id] = node->hi - node->lo;
+  }
+
+  /* stitch cells bottom-up, then clean up the joins */
+  karp_merge(&kp, 0);
+  assert(kp.lens[0] == tsp->size);
+  cand *own = tsp->cand ? NULL : cand_knn(tsp, 8);
+  ls_2opt(tsp, tsp->cand ? tsp->cand : own, kp.tours[0], kp.joins, kp.njoins);
+  path *sol = path_from_cycle(tsp, kp.tours[0], tsp->size);
+  assert(tsp_check(tsp, sol));
+  if (tsp->elite) elite_insert(tsp->elite, sol);
+  if (tsp->profile) profile_record(tsp->profile, sol->dist);
+
+  cand_free(own);
+  free(kp.tours[0]);
+  free(kp.tours);
+  free(kp.lens);
+  free(kp.joins);
+  kdtree_free(kp.kd);
+  return sol;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,228 @@
+/**
+ * @file lns.c
+ * @brief Large neighbourhood search: related cities removed from the tour and reinserted by the exact search.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define LNS_MAXNODES 9 /* max nb of nodes of a repair sub-problem (removed cities and tour fragments) */
+#define LNS_BATCH 16   /* nb of destroy and repair operations per round, on disjoint regions */
+
+/* ************************************************************************** */
+
+/* one destroy and repair operation, computed on the tour of the round */
+typedef struct lnsop {
+  uint removed[LNS_MAXNODES]; /* removed cities */
+  uint nremoved;              /* nb of removed cities */
+  uint from[LNS_MAXNODES];    /* cities whose successor changes... */
+  uint to[LNS_MAXNODES];      /* ... into these cities */
+  uint nchanges;              /* nb of changes, or 0 if no improvement */
+  long long gain;
+} lnsop;
+
+typedef struct lns {
+  TSP *tsp;
+  cand *c;
+  uint n;
+  uint *cycle; /* tour of the round */
+  uint *pos;   /* position of each city in the tour */
+  uint *succ;  /* successor of each city, with the operations of the round applied */
+  char *busy;  /* city whose successor may change in an operation of the round */
+} lns;
+
+/* ************************************************************************** */
+/*                                  DESTROY                                   */
+/* ************************************************************************** */
+
+/* cities related to a seed: spatially, by breadth-first search on candidate lists, or along the tour */
+static void lns_destroy(lns *L, lnsop *op, uint seed, uint m, bool segment) {
+  op->nremoved = 0;
+  op->removed[op->nremoved++] = seed;
+  if (segment) {
+    for (uint k = 1; k < m; k++) op->removed[op->nremoved++] = L->cycle[(L->pos[seed] + k) % L->n];
+    return;
+  }
+  for (uint head = 0; head < op->nremoved && op->nremoved < m; head++) {
+    uint a = op->removed[head];
+    for (uint k = L->c->start[a]; k < L->c->start[a + 1] && op->nremoved < m; k++) {
+      uint city = L->c->adj[k];
+      bool dup = false;
+      for (uint l = 0; l < op->nremoved && !dup; l++) dup = (op->removed[l] == city);
+      if (!dup) op->removed[op->nremoved++] = city;
+    }
+  }
+}
+
+/* ************************************************************************** */
+
+/* reserve the cities whose successor may change: the removed ones and their predecessors */
+static bool lns_claim(lns *L, lnsop *op) {
+  for (uint k = 0; k < op->nremoved; k++) {
+    uint x = op->removed[k], prev = L->cycle[(L->pos[x] + L->n - 1) % L->n];
+    if (L->busy[x] || L->busy[prev]) return false;
+  }
+  for (uint k = 0; k < op->nremoved; k++) {
+    uint x = op->removed[k];
+    L->busy[x] = L->busy[L->cycle[(L->pos[x] + L->n - 1) % L->n]] = 1;
+  }
+  return true;
+}
+
+/* ************************************************************************** */
+/*                                   REPAIR                                   */
+/* ************************************************************************** */
+
+/* nodes of the repair sub-problem in tour order: each removed city, and each tour fragment between two of
+ * them, entered by its first city (in) and left by its last one (out), as fragments keep their direction */
+static uint lns_nodes(lns *L, uint *removed, uint m, uint *in, uint *out) {
+  uint sorted[LNS_MAXNODES];
+  for (uint i = 0; i < m; i++) { /* insertion sort by tour position, as lists are short */
+    uint city = removed[i], j = i;
+    for (; j > 0 && L->pos[sorted[j - 1]] > L->pos[city]; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = city;
+  }
+  uint k = 0;
+  for (uint i = 0; i < m; i++) {
+    uint x = sorted[i];
+    uint gap = (L->pos[sorted[(i + 1) % m]] + L->n - L->pos[x]) % L->n; /* steps to the next removed city */
+    if (gap == 0) gap = L->n;
+    in[k] = out[k] = x;
+    k++;
+    if (gap == 1) continue;
+    in[k] = L->cycle[(L->pos[x] + 1) % L->n];
+    out[k] = L->cycle[(L->pos[x] + gap - 1) % L->n];
+    k++;
+  }
+  return k;
+}
+
+/* ************************************************************************** */
+
+/* reconnect the nodes by the exact search on their asymmetric distances, warm-started from the current order */
+static void lns_repair(lns *L, lnsop *op) {
+  uint in[2 * LNS_MAXNODES], out[2 * LNS_MAXNODES];
+  uint k = lns_nodes(L, op->removed, op->nremoved, in, out);
+  while (k > LNS_MAXNODES) k = lns_nodes(L, op->removed, --op->nremoved, in, out); /* least related first */
+  op->nchanges = 0;
+  op->gain = 0;
+  if (k < 3) return;
+
+  uint *distmat = malloc(k * k * sizeof(uint));
+  assert(distmat);
+  for (uint u = 0; u < k; u++)
+    for (uint v = 0; v < k; v++) distmat[u * k + v] = (u == v) ? 0 : tsp_dist(L->tsp, out[u], in[v]);
+  TSP *sub = tsp_new(k, 0, distmat, OPTIMIZE);
+  elite *pool = elite_new(sub, 1);
+  path *cur = path_new(k + 1, 0);
+  for (uint u = 0; u <= k; u++) {
+    cur->array[cur->curlen++] = u % k;
+    if (u > 0) cur->dist += distmat[(u - 1) * k + u % k];
+  }
+  elite_insert(pool, cur);
+  tsp_set_elite(sub, pool);
+  path *sol = tsp_solve(sub, NULL);
+
+  op->gain = (long long)cur->dist - sol->dist;
+  if (op->gain > 0)
+    for (uint i = 0; i < k; i++) {
+      op->from[op->nchanges] = out[sol->array[i]];
+      op->to[op->nchanges++] = in[sol->array[i + 1]];
+    }
+
+  path_free(sol);
+  path_free(cur);
+  elite_free(pool);
+  tsp_free(sub);
+  free(distmat);
+}
+
+/* ************************************************************************** */
+
+/* apply the changes of an operation to the successors, unless operations of the round together split the tour */
+static bool lns_apply(lns *L, lnsop *op) {
+  uint old[2 * LNS_MAXNODES];
+  for (uint i = 0; i < op->nchanges; i++) {
+    old[i] = L->succ[op->from[i]];
+    L->succ[op->from[i]] = op->to[i];
+  }
+  uint len = 1;
+  for (uint city = L->succ[L->cycle[0]]; city != L->cycle[0] && len <= L->n; city = L->succ[city]) len++;
+  if (len == L->n) return true;
+  for (uint i = op->nchanges; i-- > 0;) L->succ[op->from[i]] = old[i];
+  return false;
+}
+
+/* ************************************************************************** */
+
+void tsp_lns(TSP *tsp, path *p, cand *c, uint removed, uint iterations, unsigned long long seed) {
+  assert(tsp && p);
+  assert(p->curlen == tsp->size + 1);
+  assert(removed >= 2);
+  uint n = tsp->size;
+  if (removed > LNS_MAXNODES) removed = LNS_MAXNODES;
+  if (2 * removed > n) removed = n / 2; /* small instances */
+  if (removed < 2) return;
+  if (!c) c = tsp->cand;
+  cand *own = c ? NULL : cand_knn(tsp, 8);
+
+  lns L = {tsp, c ? c : own, n};
+  L.cycle = malloc(n * sizeof(uint));
+  L.pos = malloc(n * sizeof(uint));
+  L.succ = malloc(n * sizeof(uint));
+  L.busy = malloc(n * sizeof(char));
+  lnsop *ops = malloc(LNS_BATCH * sizeof(lnsop));
+  assert(L.cycle && L.pos && L.succ && L.busy && ops);
+  for (uint i = 0; i < n; i++) L.cycle[i] = p->array[i];
+  unsigned long long state = seed * 0x9E3779B97F4A7C15ULL | 1; /* xorshift state must not be 0 */
+  long long dist = p->dist;
+
+  /* rounds of operations on disjoint regions of the tour, solved in parallel, then applied in order, so that the
+   * result does not depend on the nb of threads */
+  for (uint it = 0; it < iterations; it += LNS_BATCH) {
+    for (uint i = 0; i < n; i++) {
+      L.pos[L.cycle[i]] = i;
+      L.succ[L.cycle[i]] = L.cycle[(i + 1) % n];
+      L.busy[i] = 0;
+    }
+    uint nops = 0;
+    for (uint k = 0; k < LNS_BATCH && it + k < iterations; k++) {
+      uint city = rng_next(&state) % n;
+      lns_destroy(&L, &ops[nops], city, removed, (k % 2 == 1));
+      if (lns_claim(&L, &ops[nops])) nops++;
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (uint k = 0; k < nops; k++) lns_repair(&L, &ops[k]);
+    bool improved = false;
+    for (uint k = 0; k < nops; k++)
+      if (ops[k].gain > 0 && lns_apply(&L, &ops[k])) {
+        dist -= ops[k].gain;
+        improved = true;
+      }
+    if (!improved) continue;
+    for (uint i = 1, city = L.succ[L.cycle[0]]; i < n; i++, city = L.succ[city]) L.cycle[i] = city;
+    if (tsp->profile) profile_record(tsp->profile, dist);
+  }
+
+  for (uint i = 0; i < n; i++) p->array[i] = L.cycle[i];
+  path_rotate(tsp, p);
+  assert(p->dist == dist);
+  if (tsp->elite) elite_insert(tsp->elite, p);
+  if (tsp->profile) profile_record(tsp->profile, p->dist);
+
+  free(ops);
+  free(L.busy);
+  free(L.succ);
+  free(L.pos);
+  free(L.cycle);
+  cand_free(own);
+}
+
+/* ************************************************************************** */
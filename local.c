@@ -0,0 +1,463 @@
+/**
+ * @file local.c
+ * @brief Candidate lists and local search (nearest neighbour, 2-opt).
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define LS_EXACT 8  /* max nb of free cities in a sub-path solved with the exact engine */
+#define CAND_HINT 3 /* nb of cities preselected by hint per candidate, for callback instances */
+
+/* ************************************************************************** */
+/*                               CANDIDATES                                   */
+/* ************************************************************************** */
+
+/* insert neighbour j at distance d in a sorted list of len (at most k) neighbours, ties broken by city, so
+ * that lists do not depend on the insertion order */
+static void cand_insert(uint *nbr, uint *dk, uint *len, uint k, uint j, uint d) {
+  if (*len == k && (d > dk[k - 1] || (d == dk[k - 1] && j > nbr[k - 1]))) return;
+  uint pos = (*len < k) ? (*len)++ : k - 1;
+  while (pos > 0 && (dk[pos - 1] > d || (dk[pos - 1] == d && nbr[pos - 1] > j))) {
+    nbr[pos] = nbr[pos - 1];
+    dk[pos] = dk[pos - 1];
+    pos--;
+  }
+  nbr[pos] = j;
+  dk[pos] = d;
+}
+
+/* ************************************************************************** */
+
+/* k nearest successors (or predecessors) of each city, by insertion of all distances in a sorted list of size
+ * k whose distances are kept aside */
+static void cand_scan(TSP *tsp, cand *c, uint k, bool in) {
+  uint n = tsp->size;
+#pragma omp parallel
+  {
+    uint *dk = malloc(k * sizeof(uint));
+    assert(dk);
+#pragma omp for schedule(static)
+    for (uint i = 0; i < n; i++) {
+      uint len = 0;
+      for (uint j = 0; j < n; j++)
+        if (j != i) cand_insert(&c->adj[i * k], dk, &len, k, j, in ? tsp_dist(tsp, j, i) : tsp_dist(tsp, i, j));
+    }
+    free(dk);
+  }
+}
+
+/* ************************************************************************** */
+
+static void cand_lock(char *lock) {
+  while (__sync_lock_test_and_set(lock, 1))
+    while (__atomic_load_n(lock, __ATOMIC_RELAXED));
+}
+
+static void cand_unlock(char *lock) { __sync_lock_release(lock); }
+
+/* k nearest successors (out) and predecessors (in, unless symmetric) of each city of a callback instance: among
+ * the CAND_HINT*k nearest cities by hint, whose distances are memoized as engines use them next; else from
+ * a scan of all pairs, each called once for the lists of both its cities, memoizing the k nearest only */
+static void cand_callback_scan(TSP *tsp, uint k, uint *out, uint *in) {
+  memo *m = tsp->memo;
+  uint n = tsp->size;
+  uint *dout = malloc((size_t)n * k * sizeof(uint));
+  uint *din = in ? malloc((size_t)n * k * sizeof(uint)) : NULL;
+  uint *lout = calloc(n, sizeof(uint));
+  uint *lin = calloc(n, sizeof(uint));
+  char *locks = calloc(n, sizeof(char)); /* spinlock per city, on its lists */
+  assert(dout && (din || !in) && lout && lin && locks);
+
+  if (m->hint) {
+    uint h = (CAND_HINT * k < n - 1) ? CAND_HINT * k : n - 1;
+    kdtree *kd = kdtree_new(n, m->hint, 8);
+#pragma omp parallel
+    {
+      uint *nbr = malloc(h * sizeof(uint));
+      assert(nbr);
+#pragma omp for schedule(dynamic, 16)
+      for (uint i = 0; i < n; i++) {
+        kdtree_knn(kd, i, h, nbr);
+        for (uint l = 0; l < h; l++) {
+          uint j = nbr[l];
+          cand_insert(&out[(size_t)i * k], &dout[(size_t)i * k], &lout[i], k, j, memo_dist(m, i, j));
+          if (in) cand_insert(&in[(size_t)i * k], &din[(size_t)i * k], &lin[i], k, j, memo_dist(m, j, i));
+        }
+      }
+      free(nbr);
+    }
+    kdtree_free(kd);
+  } else {
+#pragma omp parallel for schedule(dynamic, 16)
+    for (uint i = 0; i < n; i++)
+      for (uint j = in ? 0 : i + 1; j < n; j++) {
+        if (j == i) continue;
+        uint d = memo_call(m, i, j);
+        cand_lock(&locks[i]);
+        cand_insert(&out[(size_t)i * k], &dout[(size_t)i * k], &lout[i], k, j, d);
+        cand_unlock(&locks[i]);
+        cand_lock(&locks[j]);
+        if (in) cand_insert(&in[(size_t)j * k], &din[(size_t)j * k], &lin[j], k, i, d);
+        else cand_insert(&out[(size_t)j * k], &dout[(size_t)j * k], &lout[j], k, i, d);
+        cand_unlock(&locks[j]);
+      }
+    for (uint i = 0; i < n; i++)
+      for (uint l = 0; l < k; l++) {
+        memo_put(m, i, out[(size_t)i * k + l], dout[(size_t)i * k + l]);
+        if (in) memo_put(m, in[(size_t)i * k + l], i, din[(size_t)i * k + l]);
+      }
+  }
+  free(locks);
+  free(lin);
+  free(lout);
+  free(din);
+  free(dout);
+}
+
+/* k nearest successors (or predecessors) of a callback instance, computed with the other lists and kept in
+ * its memo, so that later engines fetch no distance again */
+static void cand_callback(TSP *tsp, uint k, bool in, uint *adj) {
+  memo *m = tsp->memo;
+  uint n = tsp->size;
+  in = in && !m->symmetric;
+  if (memo_knn_get(m, n, k, in, adj)) return;
+  uint *out = malloc((size_t)n * k * sizeof(uint));
+  uint *pred = m->symmetric ? NULL : malloc((size_t)n * k * sizeof(uint));
+  assert(out && (pred || m->symmetric));
+  cand_callback_scan(tsp, k, out, pred);
+  memo_knn_set(m, n, k, false, out);
+  if (pred) memo_knn_set(m, n, k, true, pred);
+  uint *lists = in ? pred : out;
+  for (size_t i = 0; i < (size_t)n * k; i++) adj[i] = lists[i];
+  free(pred);
+  free(out);
+}
+
+/* ************************************************************************** */
+
+static cand *cand_alloc(uint n, uint k) {
+  cand *c = malloc(sizeof(cand));
+  assert(c);
+  c->size = n;
+  c->start = huge_map((n + 1) * sizeof(uint));
+  c->adj = huge_map((size_t)n * k * sizeof(uint));
+  for (uint i = 0; i <= n; i++) c->start[i] = i * k;
+  return c;
+}
+
+/* ************************************************************************** */
+
+cand *cand_knn(TSP *tsp, uint k) {
+  assert(tsp);
+  uint n = tsp->size;
+  if (k > n - 1) k = n - 1;
+  cand *c = cand_alloc(n, k);
+
+  if (tsp->points) {
+    kdtree *kd = kdtree_new(n, tsp->points, 8);
+#pragma omp parallel for schedule(static)
+    for (uint i = 0; i < n; i++) kdtree_knn(kd, i, k, &c->adj[i * k]);
+    kdtree_free(kd);
+    return c;
+  }
+
+  if (tsp->memo) cand_callback(tsp, k, false, c->adj);
+  else cand_scan(tsp, c, k, false);
+  return c;
+}
+
+/* ************************************************************************** */
+
+cand *cand_knn_in(TSP *tsp, uint k) {
+  assert(tsp);
+  if (tsp->points || (tsp->memo && tsp->memo->symmetric)) return cand_knn(tsp, k);
+  uint n = tsp->size;
+  if (k > n - 1) k = n - 1;
+  cand *c = cand_alloc(n, k);
+  if (tsp->memo) cand_callback(tsp, k, true, c->adj);
+  else cand_scan(tsp, c, k, true);
+  return c;
+}
+
+/* ************************************************************************** */
+
+void cand_free(cand *c) {
+  if (c) {
+    huge_free(c->start);
+    huge_free(c->adj);
+  }
+  free(c);
+}
+
+/* ************************************************************************** */
+
+uint cand_size(cand *c) {
+  assert(c);
+  return c->start[c->size];
+}
+
+/* ************************************************************************** */
+/*                                CONSTRUCTION                                */
+/* ************************************************************************** */
+
+path *tsp_nearest(TSP *tsp) {
+  assert(tsp);
+  uint n = tsp->size;
+  uint *cycle = malloc(n * sizeof(uint));
+  bool *visited = calloc(n, sizeof(bool));
+  assert(cycle && visited);
+  cycle[0] = tsp->first;
+  visited[tsp->first] = true;
+  for (uint i = 1; i < n; i++) {
+    uint last = cycle[i - 1], best = n;
+    for (uint city = 0; city < n; city++)
+      if (!visited[city] && (best == n || tsp_dist(tsp, last, city) < tsp_dist(tsp, last, best))) best = city;
+    cycle[i] = best;
+    visited[best] = true;
+  }
+  path *p = path_from_cycle(tsp, cycle, n);
+  free(visited);
+  free(cycle);
+  return p;
+}
+
+/* ************************************************************************** */
+
+path *tsp_random(TSP *tsp, uint seed) {
+  assert(tsp);
+  uint n = tsp->size;
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ seed;
+  uint *cycle = malloc(n * sizeof(uint));
+  assert(cycle);
+  for (uint i = 0; i < n; i++) cycle[i] = i;
+  for (uint i = n - 1; i > 0; i--) { /* Fisher-Yates shuffle */
+    uint j = rng_next(&state) % (i + 1);
+    uint tmp = cycle[i];
+    cycle[i] = cycle[j];
+    cycle[j] = tmp;
+  }
+  path *p = path_from_cycle(tsp, cycle, n);
+  free(cycle);
+  return p;
+}
+
+/* ************************************************************************** */
+/*                                  2-OPT                                     */
+/* ************************************************************************** */
+
+void ls_reverse(uint *cycle, uint *pos, uint n, uint i, uint j) {
+  uint len = (j + n - i) % n + 1;
+  if (2 * len > n) {
+    uint tmp = (j + 1) % n;
+    j = (i + n - 1) % n;
+    i = tmp;
+    len = n - len;
+  }
+  for (uint k = 0; k < len / 2; k++) {
+    uint a = cycle[i], b = cycle[j];
+    cycle[i] = b;
+    pos[b] = i;
+    cycle[j] = a;
+    pos[a] = j;
+    i = (i + 1) % n;
+    j = (j + n - 1) % n;
+  }
+}
+
+/* ************************************************************************** */
+
+void ls_2opt(TSP *tsp, cand *c, uint *cycle, uint *queue, uint qlen) {
+  assert(tsp && c && cycle);
+  uint n = tsp->size;
+  if (n < 4) return;
+  uint *pos = malloc(n * sizeof(uint));
+  uint *fifo = malloc(n * sizeof(uint)); /* circular queue of active cities */
+  bool *active = calloc(n, sizeof(bool));
+  assert(pos && fifo && active);
+  for (uint i = 0; i < n; i++) pos[cycle[i]] = i;
+  uint head = 0, len = 0;
+  for (uint i = 0; i < (queue ? qlen : n); i++) {
+    uint city = queue ? queue[i] : cycle[i];
+    if (active[city]) continue;
+    active[city] = true;
+    fifo[(head + len++) % n] = city;
+  }
+
+  while (len > 0) {
+    uint a = fifo[head];
+    head = (head + 1) % n;
+    len--;
+    active[a] = false;
+    bool improved = false;
+    for (uint dir = 0; dir < 2 && !improved; dir++) {
+      /* dir 0: remove (a,succ a) and (c,succ c), dir 1: remove (pred a,a) and (pred c,c) */
+      uint b = (dir == 0) ? cycle[(pos[a] + 1) % n] : cycle[(pos[a] + n - 1) % n];
+      long long dab = tsp_dist(tsp, a, b);
+      for (uint k = c->start[a]; k < c->start[a + 1]; k++) {
+        uint city = c->adj[k];
+        long long dac = tsp_dist(tsp, a, city);
+        if (dac >= dab) break;
+        uint d = (dir == 0) ? cycle[(pos[city] + 1) % n] : cycle[(pos[city] + n - 1) % n];
+        if (city == b || d == a) continue;
+        long long gain = dab + tsp_dist(tsp, city, d) - dac - tsp_dist(tsp, b, d);
+        if (gain <= 0) continue;
+        if (dir == 0) ls_reverse(cycle, pos, n, pos[b], pos[city]);
+        else ls_reverse(cycle, pos, n, pos[a], pos[d]);
+        uint touched[4] = {a, b, city, d};
+        for (uint t = 0; t < 4; t++)
+          if (!active[touched[t]]) {
+            active[touched[t]] = true;
+            fifo[(head + len++) % n] = touched[t];
+          }
+        improved = true;
+        break;
+      }
+    }
+  }
+
+  free(active);
+  free(fifo);
+  free(pos);
+}
+
+/* ************************************************************************** */
+
+/* fetch all candidate distances at once, for a callback instance */
+static void cand_prefetch(TSP *tsp, cand *c) {
+  if (!tsp->memo) return;
+  uint n = c->size;
+  uint *pairs = malloc(2 * (size_t)c->start[n] * sizeof(uint));
+  assert(pairs);
+  for (uint i = 0; i < n; i++)
+    for (uint k = c->start[i]; k < c->start[i + 1]; k++) {
+      pairs[2 * k] = i;
+      pairs[2 * k + 1] = c->adj[k];
+    }
+  tsp_prefetch(tsp, pairs, c->start[n]);
+  free(pairs);
+}
+
+/* ************************************************************************** */
+
+void tsp_2opt(TSP *tsp, path *p, cand *c) {
+  assert(tsp && p);
+  assert(p->curlen == tsp->size + 1);
+  if (!c) c = tsp->cand;
+  cand *own = c ? NULL : cand_knn(tsp, 8);
+  if (c) cand_prefetch(tsp, c); /* own lists are memoized when built */
+  ls_2opt(tsp, c ? c : own, p->array, NULL, 0);
+  path_rotate(tsp, p);
+  if (tsp->elite) elite_insert(tsp->elite, p);
+  if (tsp->profile) profile_record(tsp->profile, p->dist);
+  cand_free(own);
+}
+
+/* ************************************************************************** */
+/*                                SUB-PATHS                                   */
+/* ************************************************************************** */
+
+static long long ls_path_dist(TSP *tsp, uint *cities, uint len) {
+  long long dist = 0;
+  for (uint i = 0; i + 1 < len; i++) dist += tsp_dist(tsp, cities[i], cities[i + 1]);
+  return dist;
+}
+
+/* ************************************************************************** */
+
+/* exact sub-path: both ends are merged in a single city 0, leaving from the first and coming back to the last */
+static void ls_path_exact(TSP *tsp, uint *cities, uint len) {
+  uint k = len - 1;
+  uint *distmat = malloc(k * k * sizeof(uint));
+  assert(distmat);
+  for (uint i = 0; i < k; i++)
+    for (uint j = 0; j < k; j++) {
+      uint from = cities[i];
+      uint to = (j == 0) ? cities[len - 1] : cities[j];
+      distmat[i * k + j] = (i == j) ? 0 : tsp_dist(tsp, from, to);
+    }
+  TSP *sub = tsp_new(k, 0, distmat, OPTIMIZE);
+  path *sol = tsp_solve(sub, NULL);
+  uint *tmp = malloc(len * sizeof(uint));
+  assert(tmp);
+  for (uint i = 0; i < k; i++) tmp[i] = cities[sol->array[i]];
+  tmp[k] = cities[len - 1];
+  for (uint i = 0; i < len; i++) cities[i] = tmp[i];
+  free(tmp);
+  path_free(sol);
+  tsp_free(sub);
+  free(distmat);
+}
+
+/* ************************************************************************** */
+
+/* first improvement 2-opt and or-opt on a small sub-path */
+static void ls_path_local(TSP *tsp, uint *c, uint len) {
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    /* 2-opt: reverse c[i+1..j] */
+    for (uint i = 0; i + 2 < len && !improved; i++)
+      for (uint j = i + 2; j + 1 < len && !improved; j++) {
+        long long gain = (long long)tsp_dist(tsp, c[i], c[i + 1]) + tsp_dist(tsp, c[j], c[j + 1]) -
+                         tsp_dist(tsp, c[i], c[j]) - tsp_dist(tsp, c[i + 1], c[j + 1]);
+        if (gain <= 0) continue;
+        for (uint a = i + 1, b = j; a < b; a++, b--) {
+          uint tmp = c[a];
+          c[a] = c[b];
+          c[b] = tmp;
+        }
+        improved = true;
+      }
+    /* or-opt: move c[i..i+l-1] between c[j] and c[j+1] */
+    for (uint l = 1; l <= 3 && !improved; l++)
+      for (uint i = 1; i + l < len && !improved; i++) {
+        uint first = c[i], last = c[i + l - 1], prev = c[i - 1], next = c[i + l];
+        long long removed = (long long)tsp_dist(tsp, prev, first) + tsp_dist(tsp, last, next) - tsp_dist(tsp, prev, next);
+        for (uint j = 0; j + 1 < len && !improved; j++) {
+          if (j + 1 >= i && j < i + l) continue;
+          long long gain = removed + tsp_dist(tsp, c[j], c[j + 1]) - tsp_dist(tsp, c[j], first) - tsp_dist(tsp, last, c[j + 1]);
+          if (gain <= 0) continue;
+          uint seg[3];
+          for (uint t = 0; t < l; t++) seg[t] = c[i + t];
+          if (j < i) { /* shift c[j+1..i-1] right */
+            for (uint t = i - 1; t > j; t--) c[t + l] = c[t];
+            for (uint t = 0; t < l; t++) c[j + 1 + t] = seg[t];
+          } else { /* shift c[i+l..j] left */
+            for (uint t = i + l; t <= j; t++) c[t - l] = c[t];
+            for (uint t = 0; t < l; t++) c[j - l + 1 + t] = seg[t];
+          }
+          improved = true;
+        }
+      }
+  }
+}
+
+/* ************************************************************************** */
+
+long long ls_path(TSP *tsp, uint *cities, uint len) {
+  assert(tsp && cities);
+  if (len < 4) return 0;
+  long long before = ls_path_dist(tsp, cities, len);
+  uint *backup = malloc(len * sizeof(uint));
+  assert(backup);
+  for (uint i = 0; i < len; i++) backup[i] = cities[i];
+  if (len - 2 <= LS_EXACT) ls_path_exact(tsp, cities, len);
+  else ls_path_local(tsp, cities, len);
+  long long gain = before - ls_path_dist(tsp, cities, len);
+  if (gain <= 0) { /* keep the original order on ties */
+    for (uint i = 0; i < len; i++) cities[i] = backup[i];
+    gain = 0;
+  }
+  free(backup);
+  return gain;
+}
+
+/* ************************************************************************** */
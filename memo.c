@@ -0,0 +1,226 @@
+/**
+ * @file memo.c
+ * @brief Distances from a user callback, fetched lazily through a concurrent sharded memo cache.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define MEMO_INIT 256 /* initial nb of slots per shard (power of 2) */
+
+/* ************************************************************************** */
+
+static void memo_lock(char *lock) {
+  while (__sync_lock_test_and_set(lock, 1))
+    while (__atomic_load_n(lock, __ATOMIC_RELAXED));
+}
+
+static void memo_unlock(char *lock) { __sync_lock_release(lock); }
+
+/* ************************************************************************** */
+
+/* splitmix64 finalizer: high bits select the shard, low bits the slot */
+static inline unsigned long long memo_hash(unsigned long long key) {
+  key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+  return key ^ (key >> 31);
+}
+
+/* ************************************************************************** */
+
+/* slot of a key in a table (linear probing): its own slot, or the empty one where it would go; keys are
+ * loaded with acquire, so that the value of a key found is the one written before it */
+static inline uint memo_slot(memo_table *t, unsigned long long key, unsigned long long h) {
+  uint mask = t->cap - 1;
+  uint slot = h & mask;
+  unsigned long long k;
+  while ((k = __atomic_load_n(&t->keys[slot], __ATOMIC_ACQUIRE)) != 0 && k != key) slot = (slot + 1) & mask;
+  return slot;
+}
+
+/* ************************************************************************** */
+
+static memo_table *memo_table_new(uint cap, memo_table *old) {
+  memo_table *t = malloc(sizeof(memo_table));
+  assert(t);
+  t->cap = cap;
+  t->keys = huge_map(cap * sizeof(unsigned long long));
+  t->vals = huge_map(cap * sizeof(uint));
+  t->old = old;
+  return t;
+}
+
+/* ************************************************************************** */
+
+/* replace the table of a shard by one twice larger, with the lock; readers still probing the old one miss at
+ * worst the pairs added meanwhile */
+static void memo_grow(shard *s) {
+  memo_table *old = s->table;
+  memo_table *t = memo_table_new(2 * old->cap, old);
+  for (uint i = 0; i < old->cap; i++)
+    if (old->keys[i] != 0) {
+      uint slot = memo_slot(t, old->keys[i], memo_hash(old->keys[i]));
+      t->keys[slot] = old->keys[i];
+      t->vals[slot] = old->vals[i];
+    }
+  __atomic_store_n(&s->table, t, __ATOMIC_RELEASE); /* published once filled */
+}
+
+/* ************************************************************************** */
+
+memo *memo_new(distfn fn, void *data, bool symmetric) {
+  assert(fn);
+  memo *m = calloc(1, sizeof(memo));
+  assert(m);
+  m->fn = fn;
+  m->data = data;
+  m->symmetric = symmetric;
+  for (uint i = 0; i < MEMO_SHARDS; i++) m->shards[i].table = memo_table_new(MEMO_INIT, NULL);
+  return m;
+}
+
+/* ************************************************************************** */
+
+void memo_free(memo *m) {
+  if (m) {
+    for (uint i = 0; i < MEMO_SHARDS; i++)
+      for (memo_table *t = m->shards[i].table, *old; t; t = old) {
+        old = t->old;
+        huge_free(t->keys);
+        huge_free(t->vals);
+        free(t);
+      }
+    free(m->knn[0]);
+    free(m->knn[1]);
+  }
+  free(m);
+}
+
+/* ************************************************************************** */
+
+uint memo_call(memo *m, uint i, uint j) {
+  __atomic_add_fetch(&m->calls, 1, __ATOMIC_RELAXED);
+  return m->fn(i, j, m->data);
+}
+
+/* ************************************************************************** */
+
+void memo_put(memo *m, uint i, uint j, uint d) {
+  if (m->symmetric && i > j) {
+    uint tmp = i;
+    i = j;
+    j = tmp;
+  }
+  unsigned long long key = (((unsigned long long)i << 32) | j) + 1; /* 0 for empty slots */
+  unsigned long long h = memo_hash(key);
+  shard *s = &m->shards[h >> (64 - MEMO_BITS)];
+  memo_lock(&s->lock);
+  memo_table *t = s->table;
+  uint slot = memo_slot(t, key, h);
+  if (t->keys[slot] == 0) {
+    t->vals[slot] = d;
+    __atomic_store_n(&t->keys[slot], key, __ATOMIC_RELEASE); /* published once its value is written */
+    if (2 * ++s->len > t->cap) memo_grow(s); /* load factor at most 1/2 */
+  }
+  memo_unlock(&s->lock);
+}
+
+/* ************************************************************************** */
+
+uint memo_dist(memo *m, uint i, uint j) {
+  if (m->symmetric && i > j) return memo_dist(m, j, i);
+  unsigned long long key = (((unsigned long long)i << 32) | j) + 1;
+  unsigned long long h = memo_hash(key);
+  memo_table *t = __atomic_load_n(&m->shards[h >> (64 - MEMO_BITS)].table, __ATOMIC_ACQUIRE);
+  uint slot = memo_slot(t, key, h); /* without lock: a key loaded with acquire is published with its value */
+  if (__atomic_load_n(&t->keys[slot], __ATOMIC_ACQUIRE) == key) return t->vals[slot];
+  /* the callback runs without lock, so that other threads are not blocked (rare duplicate calls) */
+  uint d = memo_call(m, i, j);
+  memo_put(m, i, j, d);
+  return d;
+}
+
+/* ************************************************************************** */
+
+bool memo_knn_get(memo *m, uint n, uint k, bool in, uint *adj) {
+  memo_lock(&m->lock);
+  bool found = (m->knn[in] && m->knnk[in] >= k);
+  if (found) /* the k first neighbours of longer sorted lists */
+    for (uint i = 0; i < n; i++)
+      for (uint l = 0; l < k; l++) adj[(size_t)i * k + l] = m->knn[in][(size_t)i * m->knnk[in] + l];
+  memo_unlock(&m->lock);
+  return found;
+}
+
+/* ************************************************************************** */
+
+void memo_knn_set(memo *m, uint n, uint k, bool in, uint *adj) {
+  uint *knn = malloc((size_t)n * k * sizeof(uint));
+  assert(knn);
+  for (size_t i = 0; i < (size_t)n * k; i++) knn[i] = adj[i];
+  memo_lock(&m->lock);
+  if (k > m->knnk[in]) {
+    uint *tmp = m->knn[in];
+    m->knn[in] = knn;
+    m->knnk[in] = k;
+    knn = tmp;
+  }
+  memo_unlock(&m->lock);
+  free(knn);
+}
+
+/* ************************************************************************** */
+
+TSP *tsp_new_callback(uint size, uint first, distfn fn, void *data, bool symmetric, unsigned char options) {
+  assert(fn);
+  assert(size >= 2);
+  assert(first < size);
+  TSP *tsp = calloc(1, sizeof(TSP)); /* other distance sources set to NULL */
+  assert(tsp);
+  tsp->size = size;
+  tsp->first = first;
+  tsp->options = options;
+  tsp->memo = memo_new(fn, data, symmetric);
+  return tsp;
+}
+
+/* ************************************************************************** */
+
+void tsp_set_hint(TSP *tsp, double *points) {
+  assert(tsp && tsp->memo && points);
+  tsp->memo->hint = points;
+}
+
+/* ************************************************************************** */
+
+void tsp_prefetch(TSP *tsp, uint *pairs, size_t npairs) {
+  assert(tsp);
+  assert(pairs || npairs == 0);
+  if (!tsp->memo) return;
+#pragma omp parallel for schedule(dynamic, 64)
+  for (size_t p = 0; p < npairs; p++) memo_dist(tsp->memo, pairs[2 * p], pairs[2 * p + 1]);
+}
+
+/* ************************************************************************** */
+
+void tsp_memo_stats(TSP *tsp, unsigned long long *calls, unsigned long long *pairs) {
+  assert(tsp && calls && pairs);
+  *calls = *pairs = 0;
+  if (!tsp->memo) return;
+  *calls = __atomic_load_n(&tsp->memo->calls, __ATOMIC_RELAXED);
+  for (uint i = 0; i < MEMO_SHARDS; i++) {
+    shard *s = &tsp->memo->shards[i];
+    memo_lock(&s->lock);
+    *pairs += s->len;
+    memo_unlock(&s->lock);
+  }
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,450 @@
+/**
+ * @file merge.c
+ * @brief Tour merging: exact search restricted to the union of a pool of good tours, with the edges
+ * common to all tours (backbone) fixed.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define MERGE_NODES 10000000 /* max nb of nodes explored by each search, before keeping the best tour found */
+
+/* ************************************************************************** */
+
+typedef struct merge {
+  TSP *tsp;
+  cand *graph;     /* union graph, neighbours sorted by increasing distance */
+  uint *fixed;     /* backbone neighbours: fixed[2*i] and fixed[2*i+1] (or size if none) */
+  bool symmetric;  /* symmetric distances on the union graph */
+  uint *weight;    /* lower bound of twice the cost of the edges of each city to be visited */
+  uint *end;       /* lower bound of twice the cost of the edge leaving a path end */
+  bool *visited;   /* cities in current path */
+  uint *avail;     /* nb of union neighbours still usable (unvisited, first city or path end) */
+  long long rest;  /* sum of weights over the cities still to be visited */
+  uint efirst;     /* lower bound of twice the cost of the edge closing the tour */
+  uint *count;     /* nb of complete tours explored (or NULL) */
+  unsigned long long nodes; /* nb of nodes explored by the search */
+} merge;
+
+/* ************************************************************************** */
+
+static bool merge_is_fixed(merge *m, uint a, uint b) { return m->fixed[2 * a] == b || m->fixed[2 * a + 1] == b; }
+
+static uint merge_nfixed(merge *m, uint a) {
+  uint n = m->tsp->size;
+  return (m->fixed[2 * a] != n) + (m->fixed[2 * a + 1] != n);
+}
+
+static bool merge_is_edge(merge *m, uint a, uint b) {
+  for (uint k = m->graph->start[a]; k < m->graph->start[a + 1]; k++)
+    if (m->graph->adj[k] == b) return true;
+  return false;
+}
+
+/* ************************************************************************** */
+
+/* backbone edge of city c still to be used, knowing that c was entered from prev */
+static uint merge_pending(merge *m, uint c, uint prev) {
+  uint n = m->tsp->size;
+  for (uint k = 0; k < 2; k++) {
+    uint u = m->fixed[2 * c + k];
+    if (u != n && u != prev) return u;
+  }
+  return n;
+}
+
+/* ************************************************************************** */
+
+static void merge_unleave(merge *m, uint c) {
+  if (c == m->tsp->first) return;
+  for (uint k = m->graph->start[c]; k < m->graph->start[c + 1]; k++) m->avail[m->graph->adj[k]]++;
+}
+
+/* leaving c for v makes c unusable for its neighbours: fail if an unvisited one is left with less than
+ * 2 usable neighbours, as it could not be inserted in the tour anymore */
+static bool merge_leave(merge *m, uint c, uint v) {
+  if (c == m->tsp->first) return true;
+  bool feasible = true;
+  for (uint k = m->graph->start[c]; k < m->graph->start[c + 1]; k++) {
+    uint w = m->graph->adj[k];
+    m->avail[w]--;
+    if (!m->visited[w] && w != v && m->avail[w] < 2) feasible = false;
+  }
+  if (!feasible) merge_unleave(m, c);
+  return feasible;
+}
+
+/* ************************************************************************** */
+
+static void merge_rec(merge *m, path *cur, path *sol) {
+  TSP *tsp = m->tsp;
+  uint n = tsp->size;
+  uint c = cur->array[cur->curlen - 1];
+  uint prev = (cur->curlen > 1) ? cur->array[cur->curlen - 2] : n;
+  if (++m->nodes > MERGE_NODES) return;
+
+  /* close the tour */
+  if (cur->curlen == n) {
+    uint first = tsp->first;
+    uint pending = merge_pending(m, c, prev);
+    if (pending != n && pending != first) return;
+    if (merge_pending(m, first, cur->array[1]) != n && merge_pending(m, first, cur->array[1]) != c) return;
+    if (!merge_is_edge(m, c, first)) return;
+    uint dist = cur->dist + tsp_dist(tsp, c, first);
+    if (m->count) (*m->count)++;
+    if (dist < sol->dist) {
+      for (uint i = 0; i < n; i++) sol->array[i] = cur->array[i];
+      sol->array[n] = first;
+      sol->curlen = n + 1;
+      sol->dist = dist;
+    }
+    return;
+  }
+
+  /* a backbone edge still to be used at c forces the next city (the first city may leave by any of
+   * its backbone edges, or keep its only backbone edge for closing the tour) */
+  uint forced = (prev == n) ? n : merge_pending(m, c, prev);
+  /* an unvisited neighbour with only 2 usable neighbours left must be entered from c */
+  if (prev != n)
+    for (uint k = m->graph->start[c]; k < m->graph->start[c + 1]; k++) {
+      uint v = m->graph->adj[k];
+      if (m->visited[v] || m->avail[v] > 2) continue;
+      if (forced != n && forced != v) return;
+      forced = v;
+    }
+  for (uint k = m->graph->start[c]; k < m->graph->start[c + 1]; k++) {
+    uint v = m->graph->adj[k];
+    if (m->visited[v]) continue;
+    if (forced != n && v != forced) continue;
+    if (prev == n && merge_nfixed(m, c) == 2 && !merge_is_fixed(m, c, v)) continue;
+    if (!merge_is_fixed(m, c, v) && merge_nfixed(m, v) == 2) continue; /* v must be entered by the backbone */
+    uint dist = tsp_dist(tsp, c, v);
+    if (2 * ((long long)cur->dist + dist) + m->rest - m->weight[v] + m->end[v] + m->efirst >= 2 * (long long)sol->dist) continue;
+    if (!merge_leave(m, c, v)) continue;
+    m->visited[v] = true;
+    m->rest -= m->weight[v];
+    cur->array[cur->curlen++] = v;
+    cur->dist += dist;
+    merge_rec(m, cur, sol);
+    cur->dist -= dist;
+    cur->curlen--;
+    m->rest += m->weight[v];
+    m->visited[v] = false;
+    merge_unleave(m, c);
+  }
+}
+
+/* ************************************************************************** */
+
+static merge *merge_new(TSP *tsp, path **tours, uint ntours, uint *count) {
+  uint n = tsp->size;
+  merge *m = malloc(sizeof(merge));
+  assert(m);
+  m->tsp = tsp;
+  m->count = count;
+  m->nodes = 0;
+
+  /* union graph (both directions), with at most 2 * ntours neighbours per city */
+  uint maxdeg = 2 * ntours;
+  uint *deg = calloc(n, sizeof(uint));
+  uint *nbr = malloc((size_t)n * maxdeg * sizeof(uint));
+  uint *times = calloc((size_t)n * maxdeg, sizeof(uint)); /* nb of tours using each edge */
+  assert(deg && nbr && times);
+  for (uint t = 0; t < ntours; t++) {
+    assert(tsp_check(tsp, tours[t]));
+    for (uint i = 0; i < n; i++) {
+      uint a = tours[t]->array[i], b = tours[t]->array[i + 1];
+      for (uint side = 0; side < 2; side++) {
+        uint k = 0;
+        while (k < deg[a] && nbr[a * maxdeg + k] != b) k++;
+        if (k == deg[a]) nbr[a * maxdeg + deg[a]++] = b;
+        times[a * maxdeg + k]++;
+        uint tmp = a;
+        a = b;
+        b = tmp;
+      }
+    }
+  }
+
+  /* backbone: edges found in all tours */
+  m->fixed = malloc(2 * n * sizeof(uint));
+  assert(m->fixed);
+  for (uint i = 0; i < 2 * n; i++) m->fixed[i] = n;
+  for (uint a = 0; a < n; a++)
+    for (uint k = 0, f = 0; k < deg[a]; k++)
+      if (times[a * maxdeg + k] == ntours) m->fixed[2 * a + f++] = nbr[a * maxdeg + k];
+
+  /* union graph as candidate lists sorted by distance */
+  m->graph = malloc(sizeof(cand));
+  assert(m->graph);
+  m->graph->size = n;
+  m->graph->start = malloc((n + 1) * sizeof(uint));
+  m->graph->adj = malloc((size_t)n * maxdeg * sizeof(uint));
+  assert(m->graph->start && m->graph->adj);
+  m->graph->start[0] = 0;
+  for (uint a = 0; a < n; a++) {
+    uint *adj = &m->graph->adj[m->graph->start[a]];
+    for (uint k = 0; k < deg[a]; k++) {
+      uint b = nbr[a * maxdeg + k], j = k;
+      while (j > 0 && tsp_dist(tsp, a, adj[j - 1]) > tsp_dist(tsp, a, b)) {
+        adj[j] = adj[j - 1];
+        j--;
+      }
+      adj[j] = b;
+    }
+    m->graph->start[a + 1] = m->graph->start[a] + deg[a];
+  }
+
+  /* lower bound of the remaining cost: in the symmetric case, each city still to be visited has two
+   * edges, including its backbone ones, and each edge has two ends (so weights are doubled); otherwise
+   * each city is entered once by its cheapest union edge, and so is the first city by the closing edge */
+  m->symmetric = true;
+  for (uint a = 0; a < n; a++)
+    for (uint k = m->graph->start[a]; k < m->graph->start[a + 1]; k++)
+      if (tsp_dist(tsp, a, m->graph->adj[k]) != tsp_dist(tsp, m->graph->adj[k], a)) m->symmetric = false;
+  m->weight = malloc(n * sizeof(uint));
+  m->end = malloc(n * sizeof(uint));
+  assert(m->weight && m->end);
+  m->rest = 0;
+  for (uint v = 0; v < n; v++) {
+    uint minin = UINT_MAX;
+    for (uint k = m->graph->start[v]; k < m->graph->start[v + 1]; k++)
+      if (tsp_dist(tsp, m->graph->adj[k], v) < minin) minin = tsp_dist(tsp, m->graph->adj[k], v);
+    if (m->symmetric) {
+      m->weight[v] = 0;
+      for (uint f = 0; f < 2; f++)
+        if (m->fixed[2 * v + f] != n) m->weight[v] += tsp_dist(tsp, v, m->fixed[2 * v + f]);
+      uint nfixed = merge_nfixed(m, v);
+      /* cheapest non-backbone edges complete the two edges */
+      uint other1 = UINT_MAX, other2 = UINT_MAX;
+      for (uint k = m->graph->start[v]; k < m->graph->start[v + 1]; k++) {
+        uint u = m->graph->adj[k];
+        if (merge_is_fixed(m, v, u)) continue;
+        uint d = tsp_dist(tsp, v, u);
+        if (d < other1) other2 = other1, other1 = d;
+        else if (d < other2) other2 = d;
+      }
+      if (nfixed <= 1) m->weight[v] += other1;
+      if (nfixed == 0) m->weight[v] += other2;
+      m->end[v] = minin;
+    } else {
+      m->weight[v] = 2 * minin;
+      m->end[v] = 0;
+    }
+    m->rest += m->weight[v];
+  }
+  m->efirst = m->symmetric ? m->end[tsp->first] : m->weight[tsp->first];
+  m->visited = calloc(n, sizeof(bool));
+  m->avail = malloc(n * sizeof(uint));
+  assert(m->visited && m->avail);
+  for (uint v = 0; v < n; v++) m->avail[v] = deg[v];
+  free(times);
+  free(nbr);
+  free(deg);
+  return m;
+}
+
+/* ************************************************************************** */
+
+static void merge_free(merge *m) {
+  free(m->avail);
+  free(m->visited);
+  free(m->end);
+  free(m->weight);
+  free(m->fixed);
+  cand_free(m->graph);
+  free(m);
+}
+
+/* ************************************************************************** */
+
+/* exact search on the union graph, starting from the best tour of the pool */
+static path *merge_search(merge *m, path **tours, uint ntours) {
+  TSP *tsp = m->tsp;
+  uint n = tsp->size;
+  path *sol = path_new(n + 1, UINT_MAX);
+  uint best = 0;
+  for (uint t = 1; t < ntours; t++)
+    if (tours[t]->dist < tours[best]->dist) best = t;
+  for (uint i = 0; i <= n; i++) sol->array[i] = tours[best]->array[i];
+  sol->curlen = n + 1;
+  sol->dist = tours[best]->dist;
+
+  path *cur = path_new(n + 1, 0);
+  cur->array[cur->curlen++] = tsp->first;
+  m->visited[tsp->first] = true;
+  m->rest -= m->weight[tsp->first];
+  merge_rec(m, cur, sol);
+  m->visited[tsp->first] = false;
+  m->rest += m->weight[tsp->first];
+  path_free(cur);
+  return sol;
+}
+
+/* ************************************************************************** */
+
+static uint merge_find(uint *parent, uint a) {
+  while (parent[a] != a) a = parent[a] = parent[parent[a]];
+  return a;
+}
+
+/* ************************************************************************** */
+
+/* solve the component comp, entered by its two portals p1 and p2 in every tour, as a smaller merge
+ * problem where the rest of the tour is replaced by a virtual edge (p2,p1), then write the best path
+ * back in all tours */
+static void merge_component(merge *m, path **tours, uint ntours, uint *comp, uint k, uint p1, uint p2) {
+  TSP *tsp = m->tsp;
+  uint n = tsp->size;
+  uint *local = malloc(n * sizeof(uint));
+  uint *distmat = malloc(k * k * sizeof(uint));
+  assert(local && distmat);
+  for (uint i = 0; i < n; i++) local[i] = n;
+  for (uint i = 0; i < k; i++) local[comp[i]] = i;
+  for (uint i = 0; i < k; i++)
+    for (uint j = 0; j < k; j++) distmat[i * k + j] = tsp_dist(tsp, comp[i], comp[j]);
+  distmat[local[p1] * k + local[p2]] = distmat[local[p2] * k + local[p1]] = 0;
+
+  /* each tour visits the component as a single path between p1 and p2 */
+  path **subtours = malloc(ntours * sizeof(path *));
+  uint *pos = malloc(ntours * sizeof(uint));
+  int *dir = malloc(ntours * sizeof(int));
+  assert(subtours && pos && dir);
+  TSP *sub = tsp_new(k, local[p1], distmat, 0);
+  for (uint t = 0; t < ntours; t++) {
+    uint *array = tours[t]->array;
+    pos[t] = 0;
+    while (array[pos[t]] != p1) pos[t]++;
+    dir[t] = (local[array[(pos[t] + 1) % n]] < k) ? 1 : -1;
+    subtours[t] = path_new(k + 1, 0);
+    for (uint i = 0; i < k; i++) subtours[t]->array[i] = local[array[(pos[t] + n + dir[t] * (int)i) % n]];
+    subtours[t]->array[k] = local[p1];
+    subtours[t]->curlen = k + 1;
+    path_rotate(sub, subtours[t]);
+  }
+  path *best = tsp_solve_merge(sub, subtours, ntours, m->count);
+  if (best->array[1] == local[p2]) /* orient the path from p1 to p2 */
+    for (uint a = 1, b = k - 1; a < b; a++, b--) {
+      uint tmp = best->array[a];
+      best->array[a] = best->array[b];
+      best->array[b] = tmp;
+    }
+  for (uint t = 0; t < ntours; t++) {
+    uint *array = tours[t]->array;
+    for (uint i = 0; i < k; i++) array[(pos[t] + n + dir[t] * (int)i) % n] = comp[best->array[i]];
+    array[n] = array[0];
+    path_rotate(tsp, tours[t]);
+  }
+
+  path_free(best);
+  for (uint t = 0; t < ntours; t++) path_free(subtours[t]);
+  tsp_free(sub);
+  free(dir);
+  free(pos);
+  free(subtours);
+  free(distmat);
+  free(local);
+}
+
+/* ************************************************************************** */
+
+/* split the union graph without backbone edges in connected components: those linked to the rest by
+ * exactly two backbone edges can be solved independently (symmetric instances only) */
+static bool merge_decompose(merge *m, path **tours, uint ntours) {
+  TSP *tsp = m->tsp;
+  uint n = tsp->size;
+  for (uint a = 0; a < n; a++)
+    for (uint k = m->graph->start[a]; k < m->graph->start[a + 1]; k++)
+      if (tsp_dist(tsp, a, m->graph->adj[k]) != tsp_dist(tsp, m->graph->adj[k], a)) return false;
+
+  uint *parent = malloc(n * sizeof(uint));
+  uint *size = calloc(n, sizeof(uint));
+  uint *portals = calloc(n, sizeof(uint));
+  uint *ends = malloc(2 * n * sizeof(uint));
+  uint *comp = malloc(n * sizeof(uint));
+  assert(parent && size && portals && ends && comp);
+  for (uint a = 0; a < n; a++) parent[a] = a;
+  for (uint a = 0; a < n; a++)
+    for (uint k = m->graph->start[a]; k < m->graph->start[a + 1]; k++)
+      if (!merge_is_fixed(m, a, m->graph->adj[k])) parent[merge_find(parent, a)] = merge_find(parent, m->graph->adj[k]);
+  for (uint a = 0; a < n; a++) size[merge_find(parent, a)]++;
+  for (uint a = 0; a < n; a++)
+    for (uint f = 0; f < 2; f++) {
+      uint b = m->fixed[2 * a + f], root = merge_find(parent, a);
+      if (b == n || merge_find(parent, b) == root) continue;
+      if (portals[root] < 2) ends[2 * root + portals[root]] = a;
+      portals[root]++;
+    }
+
+  bool decomposed = false;
+  for (uint root = 0; root < n; root++) {
+    if (parent[root] != root || size[root] < 4 || size[root] == n || portals[root] != 2) continue;
+    uint k = 0;
+    for (uint a = 0; a < n; a++)
+      if (merge_find(parent, a) == root) comp[k++] = a;
+    merge_component(m, tours, ntours, comp, k, ends[2 * root], ends[2 * root + 1]);
+    decomposed = true;
+  }
+
+  free(comp);
+  free(ends);
+  free(portals);
+  free(size);
+  free(parent);
+  return decomposed;
+}
+
+/* ************************************************************************** */
+
+path *tsp_solve_merge(TSP *tsp, path **tours, uint ntours, uint *count) {
+  assert(tsp && tours);
+  assert(ntours >= 1);
+  uint nelite = tsp->elite ? tsp->elite->capacity : 0;
+  path **pool = malloc((ntours + nelite) * sizeof(path *));
+  assert(pool);
+  for (uint t = 0; t < ntours; t++) {
+    pool[t] = path_new(tsp->size + 1, 0);
+    path_copy(tours[t], pool[t]);
+  }
+  if (tsp->elite) ntours += elite_snapshot(tsp->elite, &pool[ntours], nelite); /* merge elite tours too */
+
+  /* duplicate tours (in any rotation or direction) add no edge */
+  unsigned long long *hash = malloc(ntours * sizeof(unsigned long long));
+  assert(hash);
+  uint len = 0;
+  for (uint t = 0; t < ntours; t++) {
+    hash[len] = path_hash(pool[t]);
+    bool duplicate = false;
+    for (uint u = 0; u < len && !duplicate; u++) duplicate = (hash[u] == hash[len] && pool[u]->dist == pool[t]->dist);
+    if (duplicate) path_free(pool[t]);
+    else pool[len++] = pool[t];
+  }
+  ntours = len;
+  free(hash);
+
+  /* independent components become backbone once solved, then the rest is searched globally */
+  merge *m = merge_new(tsp, pool, ntours, count);
+  if (merge_decompose(m, pool, ntours)) {
+    merge_free(m);
+    m = merge_new(tsp, pool, ntours, count);
+  }
+  path *sol = merge_search(m, pool, ntours);
+  assert(tsp_check(tsp, sol));
+  if (tsp->elite) elite_insert(tsp->elite, sol);
+  if (tsp->profile) profile_record(tsp->profile, sol->dist);
+
+  merge_free(m);
+  for (uint t = 0; t < ntours; t++) path_free(pool[t]);
+  free(pool);
+  return sol;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,124 @@
+/**
+ * @file parallel.c
+ * @brief Deterministic parallel exact search: fixed subtrees, explored in epochs sharing the same bound.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+#define PAR_TASKS 1024 /* min nb of subtrees (whatever the nb of threads), if the tree is large enough */
+#define PAR_EPOCH 64   /* max nb of subtrees explored with the same incumbent bound */
+
+/* ************************************************************************** */
+
+/* enumerate all paths of len cities from first city on existing arcs, in lexicographic order */
+static void par_prefixes(TSP *tsp, uint *cur, uint curlen, uint len, bool *used, uint *prefixes, uint *nb) {
+  if (curlen == len) {
+    for (uint i = 0; i < len; i++) prefixes[*nb * len + i] = cur[i];
+    (*nb)++;
+    return;
+  }
+  for (uint city = 0; city < tsp->size; city++) {
+    if (used[city] || tsp_dist(tsp, cur[curlen - 1], city) == DIST_INF) continue;
+    used[city] = true;
+    cur[curlen] = city;
+    par_prefixes(tsp, cur, curlen + 1, len, used, prefixes, nb);
+    used[city] = false;
+  }
+}
+
+/* ************************************************************************** */
+
+/* compare two tours of the same length in lexicographic order */
+static int par_cmp(path *a, path *b) {
+  for (uint i = 0; i < a->curlen; i++)
+    if (a->array[i] != b->array[i]) return (a->array[i] < b->array[i]) ? -1 : 1;
+  return 0;
+}
+
+/* ************************************************************************** */
+
+path *tsp_solve_parallel(TSP *tsp, uint *count) {
+  assert(tsp);
+  assert(!tsp->search.checkpoint && !tsp->search.resume);
+  uint n = tsp->size;
+
+  /* fixed decomposition into the subtrees of all paths of len cities (fewer if arcs are missing) */
+  uint len = 1, ntasks = 1;
+  while (len < n - 1 && ntasks < PAR_TASKS) ntasks *= n - len++;
+  uint *prefixes = malloc((size_t)ntasks * len * sizeof(uint));
+  uint *cur = malloc(len * sizeof(uint));
+  bool *used = calloc(n, sizeof(bool));
+  assert(prefixes && cur && used);
+  cur[0] = tsp->first;
+  used[tsp->first] = true;
+  uint nb = 0;
+  par_prefixes(tsp, cur, 1, len, used, prefixes, &nb);
+  assert(nb <= ntasks);
+  ntasks = nb;
+
+  path *sol = path_new(n + 1, UINT_MAX);
+  path **best = malloc(PAR_EPOCH * sizeof(path *));
+  uint *counts = malloc(PAR_EPOCH * sizeof(uint));
+  unsigned long long *nodes = malloc(PAR_EPOCH * sizeof(unsigned long long));
+  assert(best && counts && nodes);
+  bool warm = tsp->elite && !(tsp->options & OPENPATH);
+  path *start = warm ? elite_best(tsp->elite) : NULL;
+  uint warmdist = (start && start->dist < UINT_MAX) ? start->dist : UINT_MAX;
+  if (warmdist < UINT_MAX) {
+    /* warm start, bounded one above its distance so that the lexicographically smallest optimal tour is
+     * still found by the tasks, maybe this one again */
+    path_copy(start, sol);
+    sol->dist = warmdist + 1;
+  }
+  path_free(start);
+
+  /* epochs of 1, 2, 4, ... subtrees, so that a good bound is found early */
+  uint esize = 1;
+  for (uint epoch = 0; epoch < ntasks; epoch += esize, esize = (2 * esize < PAR_EPOCH) ? 2 * esize : PAR_EPOCH) {
+    uint ntodo = (ntasks - epoch < esize) ? ntasks - epoch : esize;
+    uint bound = sol->dist; /* incumbent exchanged only between epochs */
+#pragma omp parallel for schedule(dynamic)
+    for (uint t = 0; t < ntodo; t++) {
+      TSP local = *tsp; /* own search state, silent to keep outputs in order */
+      local.options &= ~(VERBOSE | DEBUG);
+      local.search = (search){0};
+      path *p = path_new(n + 1, 0);
+      for (uint i = 0; i < len; i++) p->array[p->curlen++] = prefixes[(size_t)(epoch + t) * len + i];
+      best[t] = path_new(n + 1, bound);
+      counts[t] = 0;
+      search_run(&local, p, best[t], &counts[t]);
+      nodes[t] = local.search.nodes;
+      path_free(p);
+    }
+    /* merge in task order, ties broken by lexicographic order of tours */
+    for (uint t = 0; t < ntodo; t++) {
+      if (count) *count += counts[t];
+      tsp->search.nodes += nodes[t];
+      if (best[t]->curlen > 0 && (best[t]->dist < sol->dist || (best[t]->dist == sol->dist && par_cmp(best[t], sol) < 0)))
+        path_copy(best[t], sol);
+      path_free(best[t]);
+    }
+    if ((tsp->options & VERBOSE) && sol->curlen > 0 && sol->dist <= warmdist) path_print(sol);
+  }
+  if (warmdist < UINT_MAX && sol->dist == warmdist + 1) sol->dist = warmdist; /* warm start tour not found again */
+
+  if (warm && sol->curlen > 0) elite_insert(tsp->elite, sol);
+  free(nodes);
+  free(counts);
+  free(best);
+  free(used);
+  free(cur);
+  free(prefixes);
+  return sol;
+}
+
+/* ************************************************************************** */
@@ -0,0 +1,131 @@
+/**
+ * @file popmusic.c
+ * @brief POPMUSIC: improve a tour by optimizing sub-paths made of a few consecutive parts.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+/* ************************************************************************** */
+
+typedef struct popmusic {
+  TSP *tsp;
+  uint *cycle;   /* tour, modified in place by disjoint sub-problems */
+  uint n;        /* nb of cities */
+  uint psize;    /* nb of cities per part */
+  uint nparts;   /* nb of parts */
+  uint r;        /* nb of parts per sub-problem */
+  char *claim;   /* part currently used by a sub-problem */
+  char *pending; /* part to be (re)used as a seed */
+} popmusic;
+
+/* ************************************************************************** */
+
+/* claim the r parts of the sub-problem around a seed part, without locking */
+static bool popmusic_claim(popmusic *pm, uint seed) {
+  uint first = (seed + pm->nparts - pm->r / 2) % pm->nparts;
+  for (uint k = 0; k < pm->r; k++) {
+    uint part = (first + k) % pm->nparts;
+    if (!__sync_bool_compare_and_swap(&pm->claim[part], 0, 1)) {
+      while (k-- > 0) __sync_lock_release(&pm->claim[(first + k) % pm->nparts]);
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ************************************************************************** */
+
+static void popmusic_release(popmusic *pm, uint seed) {
+  uint first = (seed + pm->nparts - pm->r / 2) % pm->nparts;
+  for (uint k = 0; k < pm->r; k++) __sync_lock_release(&pm->claim[(first + k) % pm->nparts]);
+}
+
+/* ************************************************************************** */
+
+/* optimize the sub-path made of the r parts around a seed, and return the gain */
+static long long popmusic_optimize(popmusic *pm, uint seed) {
+  uint first = (seed + pm->nparts - pm->r / 2) % pm->nparts;
+  uint start = first * pm->psize;
+  uint len = pm->r * pm->psize;
+  if (len > pm->n) len = pm->n;
+  /* the last part may be shorter than the others */
+  for (uint k = 0; k < pm->r; k++)
+    if ((first + k) % pm->nparts == pm->nparts - 1) len -= pm->nparts * pm->psize - pm->n;
+  uint *sub = malloc(len * sizeof(uint));
+  assert(sub);
+  for (uint i = 0; i < len; i++) sub[i] = pm->cycle[(start + i) % pm->n];
+  long long gain = ls_path(pm->tsp, sub, len);
+  if (gain > 0)
+    for (uint i = 0; i < len; i++) pm->cycle[(start + i) % pm->n] = sub[i];
+  free(sub);
+  return gain;
+}
+
+/* ************************************************************************** */
+
+/* optimize the sub-problem of a seed, and mark its parts as pending again if improved */
+static void popmusic_seed(popmusic *pm, uint seed) {
+  __atomic_store_n(&pm->pending[seed], 0, __ATOMIC_RELAXED);
+  if (popmusic_optimize(pm, seed) == 0) return;
+  uint first = (seed + pm->nparts - pm->r / 2) % pm->nparts;
+  for (uint k = 0; k < pm->r; k++) __atomic_store_n(&pm->pending[(first + k) % pm->nparts], 1, __ATOMIC_RELAXED);
+}
+
+/* ************************************************************************** */
+
+void tsp_popmusic(TSP *tsp, path *p, uint psize, uint r) {
+  assert(tsp && p);
+  assert(p->curlen == tsp->size + 1);
+  assert(psize >= 1 && r >= 2);
+  popmusic pm;
+  pm.tsp = tsp;
+  pm.cycle = p->array;
+  pm.n = tsp->size;
+  pm.psize = psize;
+  pm.nparts = (pm.n + psize - 1) / psize;
+  pm.r = r;
+  if (pm.nparts < r) pm.r = pm.nparts;
+  if (pm.r * psize < 4) return;
+  pm.claim = calloc(pm.nparts, sizeof(char));
+  pm.pending = malloc(pm.nparts * sizeof(char));
+  uint *seeds = malloc(pm.nparts * sizeof(uint));
+  assert(pm.claim && pm.pending && seeds);
+  for (uint i = 0; i < pm.nparts; i++) pm.pending[i] = 1;
+
+  /* rounds over the pending seeds, spread apart so that concurrent sub-problems are far in the tour */
+  uint stride = pm.r + 1;
+  while (true) {
+    uint nseeds = 0;
+    for (uint offset = 0; offset < stride; offset++)
+      for (uint i = offset; i < pm.nparts; i += stride)
+        if (pm.pending[i]) seeds[nseeds++] = i;
+    if (nseeds == 0) break;
+    uint done = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+ : done)
+    for (uint k = 0; k < nseeds; k++) {
+      uint seed = seeds[k];
+      if (!popmusic_claim(&pm, seed)) continue; /* retried in next round */
+      popmusic_seed(&pm, seed);
+      popmusic_release(&pm, seed);
+      done++;
+    }
+    if (done == 0) popmusic_seed(&pm, seeds[0]); /* all claims collided: make progress sequentially */
+  }
+
+  path_rotate(tsp, p);
+  if (tsp->elite) elite_insert(tsp->elite, p);
+  if (tsp->profile) profile_record(tsp->profile, p->dist);
+  free(seeds);
+  free(pm.pending);
+  free(pm.claim);
+}
+
+/* ************************************************************************** */
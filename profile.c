@@ -0,0 +1,139 @@
+/**
+ * @file profile.c
+ * @brief Anytime profile: distance of the incumbent tour over time, as reported by engines.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tsp_private.h"
+
+#define PROFILE_INIT 64 /* initial nb of points */
+
+/* ************************************************************************** */
+
+struct profile {
+  struct timespec start; /* origin of times */
+  double *times;         /* time of each improvement, in seconds */
+  uint *dists;           /* incumbent distance after each improvement */
+  uint len, cap;         /* nb of points, and their capacity */
+  uint best;             /* last incumbent distance (UINT_MAX if none) */
+  char lock;             /* spinlock on points */
+};
+
+static void profile_lock(profile *pr) {
+  while (__sync_lock_test_and_set(&pr->lock, 1))
+    while (__atomic_load_n(&pr->lock, __ATOMIC_RELAXED));
+}
+
+static void profile_unlock(profile *pr) { __sync_lock_release(&pr->lock); }
+
+/* ************************************************************************** */
+
+profile *profile_new(void) {
+  profile *pr = malloc(sizeof(profile));
+  assert(pr);
+  pr->times = malloc(PROFILE_INIT * sizeof(double));
+  pr->dists = malloc(PROFILE_INIT * sizeof(uint));
+  assert(pr->times && pr->dists);
+  pr->len = 0;
+  pr->cap = PROFILE_INIT;
+  pr->best = UINT_MAX;
+  pr->lock = 0;
+  clock_gettime(CLOCK_MONOTONIC, &pr->start);
+  return pr;
+}
+
+/* ************************************************************************** */
+
+void profile_free(profile *pr) {
+  if (pr) {
+    free(pr->times);
+    free(pr->dists);
+  }
+  free(pr);
+}
+
+/* ************************************************************************** */
+
+double profile_elapsed(profile *pr) {
+  assert(pr);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - pr->start.tv_sec) + 1e-9 * (now.tv_nsec - pr->start.tv_nsec);
+}
+
+/* ************************************************************************** */
+
+void profile_record(profile *pr, uint dist) {
+  if (dist >= __atomic_load_n(&pr->best, __ATOMIC_RELAXED)) return; /* fast reject, without lock */
+  profile_lock(pr);
+  if (dist < pr->best) {
+    double t = profile_elapsed(pr); /* read in the lock, for times in the order of points */
+    if (pr->len == pr->cap) {
+      pr->cap *= 2;
+      pr->times = realloc(pr->times, pr->cap * sizeof(double));
+      pr->dists = realloc(pr->dists, pr->cap * sizeof(uint));
+      assert(pr->times && pr->dists);
+    }
+    pr->times[pr->len] = t;
+    pr->dists[pr->len++] = dist;
+    __atomic_store_n(&pr->best, dist, __ATOMIC_RELAXED);
+  }
+  profile_unlock(pr);
+}
+
+/* ************************************************************************** */
+
+uint profile_len(profile *pr) {
+  assert(pr);
+  return pr->len;
+}
+
+/* ************************************************************************** */
+
+void profile_point(profile *pr, uint i, double *time, uint *dist) {
+  assert(pr && i < pr->len);
+  if (time) *time = pr->times[i];
+  if (dist) *dist = pr->dists[i];
+}
+
+/* ************************************************************************** */
+
+uint profile_at(profile *pr, double time) {
+  assert(pr);
+  uint lo = 0, hi = pr->len; /* nb of points at or before time, by bisection */
+  while (lo < hi) {
+    uint mid = (lo + hi) / 2;
+    if (pr->times[mid] <= time) lo = mid + 1;
+    else hi = mid;
+  }
+  return (lo == 0) ? UINT_MAX : pr->dists[lo - 1];
+}
+
+/* ************************************************************************** */
+
+double profile_time_to(profile *pr, uint target) {
+  assert(pr);
+  for (uint i = 0; i < pr->len; i++)
+    if (pr->dists[i] <= target) return pr->times[i];
+  return -1.0;
+}
+
+/* ************************************************************************** */
+
+void tsp_set_profile(TSP *tsp, profile *pr) {
+  assert(tsp);
+  tsp->profile = pr;
+}
+
+/* ************************************************************************** */
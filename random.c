@@ -32,7 +32,6 @@ int main(int argc, char *argv[]) {
   if (argc == 4) seed = atoi(argv[3]);
   assert(size >= 2);
 
-  srand(seed);
   uint *distmat = distmat_random(size, seed, DISTMAX);
   distmat_print(size, distmat);
   if (filename) distmat_save(size, distmat, filename);
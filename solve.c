@@ -8,9 +8,12 @@
 
 #include <assert.h>
 #include <getopt.h>
+#include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "tsp.h"
 
@@ -20,53 +23,351 @@
 
 void usage(int argc, char *argv[]) {
   printf("Usage: %s <options>\n", argv[0]);
-  printf(" -l filename: load distance matrix [required]\n");
+  printf(" -l filename: load distance matrix [required, or -p]\n");
+  printf(" -p filename: load city coordinates\n");
   printf(" -f first: set first city [default: 0]\n");
   printf(" -v: enable verbose mode\n");
   printf(" -d: enable debug mode\n");
   printf(" -o: enable solver optimization\n");
+  printf(" -b: minimize the longest edge (bottleneck) instead of the total distance [exact search only]\n");
+  printf(" -e: search an open path, not coming back to the first city [exact search only]\n");
+  printf(" -k cellmax: solve by spatial partitioning in cells of at most cellmax cities [requires -p]\n");
+  printf(" -m ntours: merge ntours random 2-opt tours, solved exactly on their union\n");
+  printf(" -n: nearest neighbour tour improved by 2-opt (on the symmetric transformation if asymmetric)\n");
+  printf(" -g: greedy tour on candidate edges (Delaunay graph if -p) improved by 2-opt\n");
+  printf(" -r: nearest neighbour tour improved by reversal-free or-opt and or-3opt (directly on asymmetric instances)\n");
+  printf(" -u r: improve the tour with POPMUSIC, using sub-problems of r parts [requires -k]\n");
+  printf(" --checkpoint filename: save the exact search state periodically\n");
+  printf(" --period seconds: min time between two checkpoints [default: 60]\n");
+  printf(" --limit nodes: stop the exact search after a checkpoint at this nb of nodes\n");
+  printf(" --resume filename: resume the exact search from a checkpoint\n");
+  printf(" --parallel: deterministic parallel exact search [incompatible with checkpoints]\n");
+  printf(" --elite capacity: share a pool of the best distinct tours between engines, and print it\n");
+  printf(" --trace filename: write debug and verbose outputs of the exact search in a binary trace\n");
+  printf(" --sample n: trace one node every n nodes [default: 1]\n");
+  printf(" --depth d: trace only nodes of at most d cities [default: all]\n");
+  printf(" --tour filename: save the final tour in a file (or - for standard output)\n");
+  printf(" --enumerate filename: save all tours and their distances in a binary file\n");
+  printf(" --estimate probes: estimate the size and run time of the exact search, without solving\n");
+  printf(" --closure: solve on the shortest path closure of the matrix (- for missing arcs), and expand the tour\n");
+  printf("   [required by -m, -r, and by -n or -g on symmetric matrices, if some arcs are missing]\n");
+  printf(" --alpha k: share the k alpha-nearest neighbours with local search engines [symmetric instances]\n");
+  printf(" --ascent iterations: penalize distances of alpha-nearness by subgradient ascent [default: 0]\n");
+  printf(" --gls iterations: improve the 2-opt tour by guided local search [requires -n or -g]\n");
+  printf(" --lns iterations: improve the 2-opt tour by large neighbourhood search [requires -n or -g]\n");
+  printf(" --callback: get distances of city coordinates through a memoized callback [requires -p]; without --hint,\n");
+  printf("   candidate lists call it on all n(n-1)/2 pairs, in quadratic time\n");
+  printf(" --hint: preselect candidates of the callback with the city coordinates [requires --callback]\n");
+  printf(" --hugepages mode: large buffers on normal pages (off), transparent or explicit huge pages, and print\n");
+  printf("   the page sizes and huge page usage [default: transparent, not printed]\n");
   printf(" -h: print usage\n");
   exit(EXIT_FAILURE);
 }
 
 /* ************************************************************************** */
 
+/* print a tour in full for small instances only, and save it in a file if required */
+void tour_print(path *p, uint size, char *tourfile) {
+  if (size <= 26) path_print(p);
+  else printf("[ tour of %u cities ] => (%u)\n", size, path_dist(p));
+  if (tourfile) path_save(p, tourfile);
+}
+
+/* rounded euclidean distance callback, standing for an expensive distance oracle */
+uint points_callback(uint i, uint j, void *data) {
+  double *points = data;
+  double dx = points[2 * i] - points[2 * j];
+  double dy = points[2 * i + 1] - points[2 * j + 1];
+  return (uint)(sqrt(dx * dx + dy * dy) + 0.5);
+}
+
+/* ************************************************************************** */
+
 int main(int argc, char *argv[]) {
   unsigned char options = 0;
   uint first = 0; /* first city */
+  uint cellmax = 0; /* spatial partitioning */
+  uint parts = 0;   /* popmusic */
+  uint ntours = 0;  /* tour merging */
+  bool local = false; /* nearest neighbour + 2-opt */
+  bool greedy = false; /* greedy + 2-opt */
+  bool oropt = false;  /* nearest neighbour + or-3opt */
   char *filename = NULL;
+  char *pointsfile = NULL;
+  char *checkpoint = NULL;
+  char *resume = NULL;
+  uint period = 60;
+  unsigned long long limit = 0;
+  bool parallel = false;
+  uint capacity = 0; /* elite pool */
+  char *tracefile = NULL;
+  uint sample = 1, depth = 0;
+  char *tourfile = NULL;
+  char *enumfile = NULL;
+  uint probes = 0;
+  bool closure = false;
+  bool callback = false, hint = false;
+  uint alpha = 0, ascent = 0; /* alpha-nearness candidates */
+  uint glsiter = 0;           /* guided local search */
+  uint lnsiter = 0;           /* large neighbourhood search */
+  char *hugepages = NULL;     /* huge page mode */
+  struct option longopts[] = {{"checkpoint", required_argument, NULL, 'C'},
+                              {"period", required_argument, NULL, 'P'},
+                              {"limit", required_argument, NULL, 'L'},
+                              {"resume", required_argument, NULL, 'R'},
+                              {"parallel", no_argument, NULL, 'J'},
+                              {"elite", required_argument, NULL, 'E'},
+                              {"trace", required_argument, NULL, 'T'},
+                              {"sample", required_argument, NULL, 'S'},
+                              {"depth", required_argument, NULL, 'D'},
+                              {"tour", required_argument, NULL, 'W'},
+                              {"enumerate", required_argument, NULL, 'N'},
+                              {"estimate", required_argument, NULL, 'X'},
+                              {"closure", no_argument, NULL, 'Y'},
+                              {"callback", no_argument, NULL, 'Z'},
+                              {"hint", no_argument, NULL, 'I'},
+                              {"alpha", required_argument, NULL, 'A'},
+                              {"ascent", required_argument, NULL, 'B'},
+                              {"gls", required_argument, NULL, 'G'},
+                              {"lns", required_argument, NULL, 'Q'},
+                              {"hugepages", required_argument, NULL, 'H'},
+                              {NULL, 0, NULL, 0}};
   int c;
-  while ((c = getopt(argc, argv, "vdhol:f:")) != -1) {
+  while ((c = getopt_long(argc, argv, "vdhobengrl:f:p:k:u:m:", longopts, NULL)) != -1) {
+    if (c == 'C') checkpoint = optarg;
+    if (c == 'P') period = atoi(optarg);
+    if (c == 'L') limit = strtoull(optarg, NULL, 10);
+    if (c == 'R') resume = optarg;
+    if (c == 'J') parallel = true;
+    if (c == 'E') capacity = atoi(optarg);
+    if (c == 'T') tracefile = optarg;
+    if (c == 'S') sample = atoi(optarg);
+    if (c == 'D') depth = atoi(optarg);
+    if (c == 'W') tourfile = optarg;
+    if (c == 'N') enumfile = optarg;
+    if (c == 'X') probes = atoi(optarg);
+    if (c == 'Y') closure = true;
+    if (c == 'Z') callback = true;
+    if (c == 'I') hint = true;
+    if (c == 'A') alpha = atoi(optarg);
+    if (c == 'B') ascent = atoi(optarg);
+    if (c == 'G') glsiter = atoi(optarg);
+    if (c == 'Q') lnsiter = atoi(optarg);
+    if (c == 'H') hugepages = optarg;
     if (c == 'f') first = atoi(optarg);
     if (c == 'l') filename = optarg;
+    if (c == 'p') pointsfile = optarg;
+    if (c == 'k') cellmax = atoi(optarg);
+    if (c == 'u') parts = atoi(optarg);
+    if (c == 'm') ntours = atoi(optarg);
+    if (c == 'n') local = true;
+    if (c == 'g') greedy = true;
+    if (c == 'r') oropt = true;
     if (c == 'v') options |= VERBOSE;
     if (c == 'd') options |= (VERBOSE | DEBUG);
     if (c == 'o') options |= OPTIMIZE;
+    if (c == 'b') options |= BOTTLENECK;
+    if (c == 'e') options |= OPENPATH;
     if (c == 'h') usage(argc, argv);
   }
-  if (!filename) usage(argc, argv);
+  if (!filename && !pointsfile) usage(argc, argv);
+  if (cellmax > 0 && !pointsfile) usage(argc, argv);
+  if (parts > 0 && cellmax == 0) usage(argc, argv);
+  if (limit > 0 && !checkpoint) usage(argc, argv);
+  if (parallel && (checkpoint || resume)) usage(argc, argv);
+  if (sample < 1) usage(argc, argv);
+  if (probes == 1) usage(argc, argv);
+  if (closure && !filename) usage(argc, argv);
+  if (callback && !pointsfile) usage(argc, argv);
+  if (hint && !callback) usage(argc, argv);
+  if (ascent > 0 && alpha == 0) usage(argc, argv);
+  if (glsiter > 0 && !local && !greedy) usage(argc, argv);
+  if (lnsiter > 0 && !local && !greedy) usage(argc, argv);
+  bool heuristic = cellmax > 0 || ntours > 0 || local || greedy || oropt; /* closed tours of min-sum only */
+  if ((options & (BOTTLENECK | OPENPATH)) && heuristic) usage(argc, argv);
+  if (hugepages) {
+    if (strcmp(hugepages, "off") == 0) huge_set_mode(HUGE_OFF);
+    else if (strcmp(hugepages, "transparent") == 0) huge_set_mode(HUGE_TRANSPARENT);
+    else if (strcmp(hugepages, "explicit") == 0) huge_set_mode(HUGE_EXPLICIT);
+    else usage(argc, argv);
+  }
 
-  /* create distance matrix */
+  /* create distance matrix or city coordinates */
   uint size = 0;
-  uint *distmat = distmat_load(filename, &size);
+  uint *distmat = NULL;
+  double *points = NULL;
+  if (pointsfile) points = points_load(pointsfile, &size);
+  else distmat = distmat_load(filename, &size);
+  uint *next = NULL; /* shortest paths of the closure */
+  if (closure) {
+    distmat_print(size, distmat);
+    next = malloc((size_t)size * size * sizeof(uint));
+    assert(next);
+    uint *metric = distmat_closure(size, distmat, next);
+    free(distmat);
+    distmat = metric;
+    printf("Shortest path closure computed.\n");
+  }
 
   /* check arguments */
-  assert(distmat);
-  assert(size >= 2 && size <= 26); /* city names in range [A,Z] */
+  assert(distmat || points);
+  assert(size >= 2);
   assert(first >= 0 && first < size);
+  bool missing = false; /* missing arcs, only avoided by the exact search and the symmetric transformation */
+  for (uint i = 0; distmat && i < size * size && !missing; i++)
+    missing = (distmat[i] == DIST_INF && i % (size + 1) != 0);
 
   /* run solver */
-  TSP *tsp = tsp_new(size, first, distmat, options);
+  TSP *tsp = NULL;
+  if (missing && (ntours > 0 || oropt)) {
+    fprintf(stderr, "Error: missing arcs in \"%s\", use --closure\n", filename);
+    exit(EXIT_FAILURE);
+  }
+  if (callback) tsp = tsp_new_callback(size, first, points_callback, points, true, options);
+  else if (points) tsp = tsp_new_points(size, first, points, options);
+  else tsp = tsp_new(size, first, distmat, options);
+  if (hint) tsp_set_hint(tsp, points);
+  if (missing && (local || greedy) && probes == 0 && tsp_symmetric(tsp)) {
+    fprintf(stderr, "Error: missing arcs in \"%s\", use --closure\n", filename);
+    exit(EXIT_FAILURE);
+  }
   uint count = 0;
-  printf("TSP problem of size %u starting from city %c.\n", size, 'A' + first);
-  distmat_print(size, distmat);
-  printf("Starting path exploration...\n");
-  path *sol = tsp_solve(tsp, &count);
-  printf("TSP solved after %u paths fully explored.\n", count);
-  path_print(sol);
+  elite *pool = capacity > 0 ? elite_new(tsp, capacity) : NULL;
+  tsp_set_elite(tsp, pool);
+  trace *tr = tracefile ? trace_new(tracefile, size, sample, depth) : NULL;
+  tsp_set_trace(tsp, tr);
+  if (size <= 26) printf("TSP problem of size %u starting from city %c.\n", size, 'A' + first);
+  else printf("TSP problem of size %u starting from city %u.\n", size, first);
+  if (distmat) distmat_print(size, distmat);
+  else points_summary(size, points);
+  cand *shared = NULL;
+  if (alpha > 0 && tsp_symmetric(tsp)) {
+    shared = cand_alpha(tsp, alpha, ascent);
+    tsp_set_cand(tsp, shared);
+    printf("Alpha-nearness candidates: %u per city, after %u ascent iterations.\n", alpha, ascent);
+  }
+  if (enumfile) {
+    unsigned long long nb = tsp_iter_save(tsp, enumfile);
+    printf("%llu tours saved in \"%s\".\n", nb, enumfile);
+  }
+  path *sol = NULL;
+  if (probes > 0) {
+    estimate est;
+    tsp_estimate(tsp, probes, 0, &est);
+    printf("Estimated search: %.3g nodes [%.3g, %.3g], %.3g s [%.3g, %.3g], %.3g complete paths, %.3g nodes/s.\n",
+           est.nodes, est.nodes_low, est.nodes_high, est.seconds, est.seconds_low, est.seconds_high, est.paths,
+           est.rate);
+  } else if (cellmax > 0) {
+    printf("Starting spatial partitioning in cells of at most %u cities...\n", cellmax);
+    sol = tsp_solve_karp(tsp, cellmax);
+    printf("TSP solved by spatial partitioning.\n");
+    if (parts > 0) {
+      tour_print(sol, size, NULL);
+      tsp_popmusic(tsp, sol, cellmax, parts);
+      printf("TSP improved by POPMUSIC with %u parts of %u cities.\n", parts, cellmax);
+    }
+  } else if (ntours > 0) {
+    printf("Starting tour merging of %u random 2-opt tours...\n", ntours);
+    path **tours = malloc(ntours * sizeof(path *));
+    assert(tours);
+    for (uint i = 0; i < ntours; i++) {
+      tours[i] = tsp_random(tsp, i);
+      tsp_2opt(tsp, tours[i], NULL);
+      tour_print(tours[i], size, NULL);
+    }
+    sol = tsp_solve_merge(tsp, tours, ntours, &count);
+    printf("TSP solved after %u merged tours fully explored.\n", count);
+    for (uint i = 0; i < ntours; i++) path_free(tours[i]);
+    free(tours);
+  } else if (oropt) {
+    printf("Starting or-3opt...\n");
+    sol = tsp_nearest(tsp);
+    tsp_or3opt(tsp, sol, NULL, NULL);
+    assert(tsp_check(tsp, sol));
+    printf("TSP solved by nearest neighbour and or-3opt.\n");
+  } else if (local || greedy) {
+    bool sym = tsp_symmetric(tsp);
+    TSP *work = sym ? tsp : tsp_new_sym(tsp);
+    if (!sym) printf("Starting 2-opt on the symmetric transformation (%u nodes)...\n", 2 * size);
+    else printf("Starting 2-opt...\n");
+    cand *cands = (greedy && sym && points && !callback && !shared) ? cand_delaunay(tsp) : NULL;
+    if (cands) printf("Delaunay graph of %u edges.\n", cand_size(cands) / 2);
+    path *tour = greedy ? tsp_greedy(work, cands) : tsp_nearest(work);
+    tsp_2opt(work, tour, cands);
+    if (glsiter > 0) {
+      tour_print(tour, size, NULL);
+      tsp_gls(work, tour, cands, glsiter);
+      printf("Tour improved by %u iterations of guided local search.\n", glsiter);
+    }
+    if (lnsiter > 0) {
+      tour_print(tour, size, NULL);
+      tsp_lns(work, tour, cands, 8, lnsiter, 0);
+      printf("Tour improved by %u iterations of large neighbourhood search.\n", lnsiter);
+    }
+    sol = sym ? tour : path_from_sym(work, tour);
+    if (missing && !tsp_check(tsp, sol)) { /* forbidden edges left in the symmetric tour */
+      fprintf(stderr, "Error: no tour found without the missing arcs of \"%s\", use --closure\n", filename);
+      exit(EXIT_FAILURE);
+    }
+    assert(tsp_check(tsp, sol));
+    if (greedy) printf("TSP solved by greedy edges and 2-opt.\n");
+    else printf("TSP solved by nearest neighbour and 2-opt.\n");
+    cand_free(cands);
+    if (!sym) {
+      path_free(tour);
+      tsp_free(work);
+    }
+  } else {
+    if (checkpoint) tsp_set_checkpoint(tsp, checkpoint, period, limit);
+    if (resume) {
+      printf("Resuming path exploration from \"%s\"...\n", resume);
+      tsp_resume(tsp, resume);
+    } else {
+      printf("Starting path exploration...\n");
+    }
+    sol = parallel ? tsp_solve_parallel(tsp, &count) : tsp_solve(tsp, &count);
+    if (tsp_stopped(tsp))
+      printf("TSP search stopped after %u paths fully explored (%llu nodes).\n", count, tsp_nodes(tsp));
+    else printf("TSP solved after %u paths fully explored (%llu nodes).\n", count, tsp_nodes(tsp));
+    if (path_dist(sol) == UINT_MAX) { /* no tour: all use missing arcs, or stopped before the first one */
+      if (!tsp_stopped(tsp)) printf("No tour without the missing arcs.\n");
+      path_free(sol);
+      sol = NULL;
+    }
+  }
+  if (sol) tour_print(sol, size, tourfile);
+  if (sol && next) {
+    path *expanded = path_expand(sol, size, next);
+    printf("Expanded tour on the original arcs:\n");
+    path_print(expanded);
+    path_free(expanded);
+  }
   path_free(sol);
+  if (callback) {
+    unsigned long long calls, pairs;
+    tsp_memo_stats(tsp, &calls, &pairs);
+    printf("Distance callback: %llu calls, %llu pairs memoized (%.2f%% of all pairs).\n", calls, pairs,
+           200.0 * pairs / ((double)size * (size - 1)));
+  }
+  if (hugepages) huge_summary();
+  if (pool) {
+    path **tours = malloc(capacity * sizeof(path *));
+    assert(tours);
+    uint len = elite_snapshot(pool, tours, capacity);
+    printf("Elite pool of %u tours:\n", len);
+    for (uint i = 0; i < len; i++) {
+      tour_print(tours[i], size, NULL);
+      path_free(tours[i]);
+    }
+    free(tours);
+    elite_free(pool);
+  }
+  trace_free(tr);
+  cand_free(shared);
   tsp_free(tsp);
   free(distmat);
+  free(next);
+  free(points);
 
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,105 @@
+/**
+ * @file sym.c
+ * @brief Symmetric transformation of asymmetric instances (Jonker-Volgenant), computed on the fly.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp_private.h"
+
+/* ************************************************************************** */
+
+bool tsp_symmetric(TSP *tsp) {
+  assert(tsp);
+  if (tsp->points) return true;
+  if (tsp->memo) return tsp->memo->symmetric; /* as declared, without fetching all pairs */
+  for (uint i = 0; i < tsp->size; i++)
+    for (uint j = 0; j < i; j++)
+      if (tsp_dist(tsp, i, j) != tsp_dist(tsp, j, i)) return false;
+  return true;
+}
+
+/* ************************************************************************** */
+
+TSP *tsp_new_sym(TSP *asym) {
+  assert(asym);
+  uint n = asym->size;
+  unsigned long long maxd = 0; /* longest arc, missing arcs being mapped to forbidden edges */
+  for (uint i = 0; i < n; i++)
+    for (uint j = 0; j < n; j++) {
+      uint d = tsp_dist(asym, i, j);
+      if (i != j && d != DIST_INF && d > maxd) maxd = d;
+    }
+
+  /* A tour of the 2n nodes sums 2n edges, which must not overflow. If possible, ghost and forbidden
+   * costs are large enough for optimal symmetric tours to be optimal asymmetric tours (any tour skipping
+   * a ghost edge, or using forbidden edges, is longer). Otherwise, they are only large enough for
+   * improving 2-opt and or-opt moves to never break a ghost edge or add a forbidden one. */
+  unsigned long long ghost = n * maxd + 1;
+  unsigned long long forbidden = n * (ghost + maxd) / 2 + 1;
+  unsigned long long limit = UINT_MAX / (2ULL * n);
+  if (forbidden > limit) {
+    ghost = 4 * maxd + 1;
+    forbidden = limit;
+    if (forbidden <= 3 * (ghost + maxd)) {
+      fprintf(stderr, "Error: distances too large for the symmetric transformation of %u cities\n", n);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  TSP *tsp = calloc(1, sizeof(TSP));
+  assert(tsp);
+  tsp->size = 2 * n;
+  tsp->first = asym->first;
+  tsp->options = asym->options;
+  tsp->asym = asym;
+  tsp->ghost = (uint)ghost;
+  tsp->forbidden = (uint)forbidden;
+  return tsp;
+}
+
+/* ************************************************************************** */
+
+path *path_to_sym(TSP *sym, path *p) {
+  assert(sym && sym->asym && p);
+  uint n = sym->asym->size;
+  assert(tsp_check(sym->asym, p));
+  uint *cycle = malloc(2 * n * sizeof(uint));
+  assert(cycle);
+  for (uint i = 0; i < n; i++) {
+    cycle[2 * i] = p->array[i];         /* in-node */
+    cycle[2 * i + 1] = p->array[i] + n; /* out-node */
+  }
+  path *q = path_from_cycle(sym, cycle, 2 * n);
+  free(cycle);
+  return q;
+}
+
+/* ************************************************************************** */
+
+path *path_from_sym(TSP *sym, path *p) {
+  assert(sym && sym->asym && p);
+  uint n = sym->asym->size;
+  assert(p->curlen == 2 * n + 1);
+  /* walk the cycle in the direction where each in-node is followed by its out-node */
+  int dir = (p->array[1] == p->array[0] + n) ? 1 : -1;
+  uint *cycle = malloc(n * sizeof(uint));
+  assert(cycle);
+  for (uint i = 0; i < n; i++) {
+    uint in = p->array[(2 * n + dir * (int)(2 * i)) % (2 * n)];
+    assert(in < n && p->array[(2 * n + dir * (int)(2 * i + 1)) % (2 * n)] == in + n); /* ghost edges all used */
+    cycle[i] = in;
+  }
+  path *q = path_from_cycle(sym->asym, cycle, n);
+  free(cycle);
+  return q;
+}
+
+/* ************************************************************************** */
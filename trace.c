@@ -0,0 +1,214 @@
+/**
+ * @file trace.c
+ * @brief Binary trace of the exact search, buffered per thread, and its decoder.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tsp_private.h"
+
+#define TRACE_MAGIC "TSPTRC01"
+#define TRACE_BUFSIZE 4096 /* nb of records per thread buffer */
+
+/* ************************************************************************** */
+
+typedef struct trace_rec {
+  unsigned char event;  /* TRACE_CITY, TRACE_NODE or TRACE_SOLUTION */
+  unsigned char pad;    /* unused */
+  unsigned short depth; /* path length, the city being the last one */
+  uint city;            /* last city of the path */
+  uint cost;            /* path distance (only for nodes and solutions) */
+} trace_rec;
+
+/* records of one thread, appended to the file as a block when full */
+typedef struct tracebuf {
+  struct trace *tr;              /* owner */
+  uint thread;                   /* thread id in the trace */
+  trace_rec recs[TRACE_BUFSIZE]; /* buffered records */
+  uint len;                      /* nb of records */
+  unsigned long long nodes;      /* nb of nodes seen, for sampling */
+  uint *shadow;                  /* path as known by the decoder after the last record */
+  uint shadowlen;                /* length of this path */
+  struct tracebuf *next;         /* next buffer of the same trace */
+} tracebuf;
+
+struct trace {
+  unsigned long long id; /* unique trace id */
+  FILE *file;            /* trace file */
+  char *filename;        /* its name, for error messages */
+  uint maxlen;           /* max path length */
+  uint sample;           /* record one node every sample nodes */
+  uint maxdepth;         /* record only nodes of at most maxdepth cities */
+  uint nthreads;         /* nb of thread buffers */
+  tracebuf *bufs;        /* all thread buffers */
+  char lock;             /* spinlock on file and buffer list */
+};
+
+enum { TRACE_CITY = 0, TRACE_NODE = 1, TRACE_SOLUTION = 2 };
+
+static unsigned long long trace_ids = 0;               /* nb of traces created */
+static __thread tracebuf *trace_local = NULL;          /* buffer of the calling thread */
+static __thread unsigned long long trace_local_id = 0; /* id of its trace, as it may be freed */
+
+/* ************************************************************************** */
+
+static void trace_lock(trace *tr) {
+  while (__sync_lock_test_and_set(&tr->lock, 1))
+    while (__atomic_load_n(&tr->lock, __ATOMIC_RELAXED));
+}
+
+static void trace_unlock(trace *tr) { __sync_lock_release(&tr->lock); }
+
+/* ************************************************************************** */
+
+/* append a buffer to the file as a block: thread id, nb of records, records */
+static void trace_flush(tracebuf *b) {
+  if (b->len == 0) return;
+  trace *tr = b->tr;
+  uint header[2] = {b->thread, b->len};
+  trace_lock(tr);
+  if (fwrite(header, sizeof(uint), 2, tr->file) != 2 || fwrite(b->recs, sizeof(trace_rec), b->len, tr->file) != b->len)
+    file_fail(tr->filename, "cannot write trace");
+  trace_unlock(tr);
+  b->len = 0;
+}
+
+/* ************************************************************************** */
+
+static tracebuf *trace_buf(trace *tr) {
+  if (trace_local && trace_local_id == tr->id) return trace_local;
+  tracebuf *b = calloc(1, sizeof(tracebuf));
+  assert(b);
+  b->tr = tr;
+  b->shadow = malloc(tr->maxlen * sizeof(uint));
+  assert(b->shadow);
+  trace_lock(tr);
+  b->thread = tr->nthreads++;
+  b->next = tr->bufs;
+  tr->bufs = b;
+  trace_unlock(tr);
+  trace_local = b;
+  trace_local_id = tr->id;
+  return b;
+}
+
+/* ************************************************************************** */
+
+trace *trace_new(char *filename, uint size, uint sample, uint maxdepth) {
+  assert(filename);
+  assert(sample >= 1);
+  trace *tr = calloc(1, sizeof(trace));
+  assert(tr);
+  tr->filename = malloc(strlen(filename) + 1);
+  assert(tr->filename);
+  strcpy(tr->filename, filename);
+  tr->file = fopen(filename, "wb");
+  if (!tr->file) file_fail(filename, "cannot write trace");
+  tr->id = __sync_add_and_fetch(&trace_ids, 1);
+  tr->maxlen = size + 1;
+  tr->sample = sample;
+  tr->maxdepth = maxdepth ? maxdepth : UINT_MAX;
+  if (fwrite(TRACE_MAGIC, 1, 8, tr->file) != 8 || fwrite(&tr->maxlen, sizeof(uint), 1, tr->file) != 1)
+    file_fail(filename, "cannot write trace");
+  return tr;
+}
+
+/* ************************************************************************** */
+
+void trace_free(trace *tr) {
+  if (!tr) return;
+  for (tracebuf *b = tr->bufs; b;) {
+    trace_flush(b);
+    tracebuf *next = b->next;
+    free(b->shadow);
+    free(b);
+    b = next;
+  }
+  if (fclose(tr->file) != 0) file_fail(tr->filename, "cannot write trace");
+  free(tr->filename);
+  free(tr);
+}
+
+/* ************************************************************************** */
+
+void trace_path(trace *tr, path *p, bool solution) {
+  tracebuf *b = trace_buf(tr);
+  if (!solution) {
+    if (p->curlen > tr->maxdepth) return;
+    if (b->nodes++ % tr->sample != 0) return;
+  }
+  /* only the cities changed since the last record, at least the last one */
+  uint d = 0;
+  while (d + 1 < p->curlen && d < b->shadowlen && b->shadow[d] == p->array[d]) d++;
+  for (; d < p->curlen; d++) {
+    bool last = (d + 1 == p->curlen);
+    trace_rec *rec = &b->recs[b->len++];
+    rec->event = !last ? TRACE_CITY : solution ? TRACE_SOLUTION : TRACE_NODE;
+    rec->pad = 0;
+    rec->depth = d + 1;
+    rec->city = p->array[d];
+    rec->cost = last ? p->dist : 0;
+    b->shadow[d] = p->array[d];
+    if (b->len == TRACE_BUFSIZE) trace_flush(b);
+  }
+  b->shadowlen = p->curlen;
+}
+
+/* ************************************************************************** */
+
+void tsp_set_trace(TSP *tsp, trace *tr) {
+  assert(tsp);
+  assert(!tr || tr->maxlen == tsp->size + 1);
+  tsp->trace = tr;
+}
+
+/* ************************************************************************** */
+
+void trace_print(char *filename) {
+  assert(filename);
+  FILE *file = fopen(filename, "rb");
+  if (!file) file_fail(filename, "cannot read trace");
+  char magic[8];
+  uint maxlen;
+  if (fread(magic, 1, 8, file) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0) file_fail(filename, "not a trace");
+  if (fread(&maxlen, sizeof(uint), 1, file) != 1 || maxlen < 1) file_fail(filename, "truncated or corrupted trace");
+
+  /* one path per thread, rebuilt from its records */
+  uint nthreads = 0;
+  path **paths = NULL;
+  trace_rec *recs = malloc(TRACE_BUFSIZE * sizeof(trace_rec));
+  assert(recs);
+  uint header[2];
+  while (fread(header, sizeof(uint), 2, file) == 2) {
+    if (header[1] > TRACE_BUFSIZE || fread(recs, sizeof(trace_rec), header[1], file) != header[1])
+      file_fail(filename, "truncated or corrupted trace");
+    while (header[0] >= nthreads) {
+      paths = realloc(paths, (nthreads + 1) * sizeof(path *));
+      assert(paths);
+      paths[nthreads++] = path_new(maxlen, 0);
+    }
+    path *p = paths[header[0]];
+    for (uint i = 0; i < header[1]; i++) {
+      if (recs[i].depth < 1 || recs[i].depth > maxlen) file_fail(filename, "truncated or corrupted trace");
+      p->array[recs[i].depth - 1] = recs[i].city;
+      p->curlen = recs[i].depth;
+      p->dist = recs[i].cost;
+      if (recs[i].event != TRACE_CITY) path_print(p);
+    }
+  }
+
+  for (uint t = 0; t < nthreads; t++) path_free(paths[t]);
+  free(paths);
+  free(recs);
+  fclose(file);
+}
+
+/* ************************************************************************** */
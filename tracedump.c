@@ -0,0 +1,21 @@
+/**
+ * @file tracedump.c
+ * @brief Print a binary trace of the exact search.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tsp.h"
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    printf("Usage: %s <tracefile>\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  trace_print(argv[1]);
+  return EXIT_SUCCESS;
+}
@@ -12,29 +12,10 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
-#include "tsp.h"
-
-/* ************************************************************************** */
-/*                                TYPES                                       */
-/* ************************************************************************** */
-
-typedef struct TSP {
-  uint size;             /* nb of cities (problem size)) */
-  uint first;            /* first city */
-  uint *distmat;         /* distance matrix */
-  unsigned char options; /* options: verbose, debug, optimize, ... */
-} TSP;
-
-/* ************************************************************************** */
-
-typedef struct path {
-  uint *array; /* array of cities in path */
-  uint curlen; /* current length of path */
-  uint maxlen; /* max length of path */
-  uint dist;   /* current distance of path */
-} path;
+#include "tsp_private.h"
 
 /* ************************************************************************** */
 /*                                    PATH                                    */
@@ -47,14 +28,14 @@ path *path_new(uint maxlen, uint dist) {
   p->maxlen = maxlen;
   p->curlen = 0;
   p->dist = dist;
-  p->array = calloc(maxlen, sizeof(uint));
+  p->array = calloc(maxlen, sizeof(uint)); /* small and short-lived: not worth huge pages */
   assert(p->array);
   return p;
 }
 
 /* ************************************************************************** */
 
-static void path_copy(path *src, path *dst) {
+void path_copy(path *src, path *dst) {
   assert(src && dst);
   dst->maxlen = src->maxlen;
   dst->curlen = src->curlen;
@@ -73,69 +54,120 @@ void path_free(path *p) {
 
 void path_print(path *p) {
   assert(p);
+  bool letters = (p->maxlen <= 27); /* city names in range [A,Z], numeric ids beyond */
   printf("[ ");
-  for (uint i = 0; i < p->curlen; i++) printf("%c ", 'A' + p->array[i]);
+  for (uint i = 0; i < p->curlen; i++) {
+    if (letters) printf("%c ", 'A' + p->array[i]);
+    else printf("%u ", p->array[i]);
+  }
   for (uint i = p->curlen; i < p->maxlen; i++) printf("- ");
   printf("] => (%u)\n", p->dist);
 }
 
 /* ************************************************************************** */
 
+void path_save(path *p, char *filename) {
+  assert(p && filename);
+  bool stream = (strcmp(filename, "-") == 0);
+  FILE *file = stream ? stdout : fopen(filename, "w");
+  assert(file);
+  fprintf(file, "%u %u\n", p->curlen, p->dist);
+  for (uint i = 0; i < p->curlen; i++) fprintf(file, "%u\n", p->array[i]);
+  if (!stream) fclose(file);
+}
+
+/* ************************************************************************** */
+
+/* distance of a path, for the objective of the instance */
 static void path_update_dist(TSP *tsp, path *p) {
-  uint distsum = 0;
-  for (uint i = 0; i < p->curlen - 1; i++) {
-    int first = p->array[i];
-    int second = p->array[i + 1];
-    uint dist = tsp->distmat[first * tsp->size + second];
-    distsum += dist;
+  uint dist = 0;
+  for (uint i = 0; i + 1 < p->curlen; i++) {
+    uint d = tsp_dist(tsp, p->array[i], p->array[i + 1]);
+    if (tsp->options & BOTTLENECK) dist = (d > dist) ? d : dist;
+    else dist += d;
   }
-  p->dist = distsum;
+  p->dist = dist;
 }
 
 /* ************************************************************************** */
 
-static void path_push(TSP *tsp, path *p, uint city) {
+uint path_dist(path *p) {
   assert(p);
-  assert(p->curlen < p->maxlen);
-  assert(city < p->maxlen);
-  p->array[p->curlen] = city;
-  p->curlen++;
-  path_update_dist(tsp, p);
+  return p->dist;
 }
 
 /* ************************************************************************** */
 
-static void path_pop(TSP *tsp, path *p) {
-  assert(p);
-  assert(p->curlen > 0);
-  p->curlen--;
+bool path_equal(path *p, path *q) {
+  assert(p && q);
+  if (p->curlen != q->curlen) return false;
+  for (uint i = 0; i < p->curlen; i++)
+    if (p->array[i] != q->array[i]) return false;
+  return true;
+}
+
+/* ************************************************************************** */
+
+path *path_from_cycle(TSP *tsp, uint *cycle, uint n) {
+  assert(tsp && cycle);
+  assert(n == tsp->size);
+  path *p = path_new(n + 1, 0);
+  uint start = 0;
+  while (cycle[start] != tsp->first) start++;
+  for (uint i = 0; i <= n; i++) p->array[i] = cycle[(start + i) % n];
+  p->curlen = n + 1;
   path_update_dist(tsp, p);
+  return p;
 }
 
 /* ************************************************************************** */
 
-static bool path_check(TSP *tsp, path *cur, path *sol) {
-  assert(cur);
-  /* check if current path is invalid */
-  if (cur->curlen <= 1) return true;
-  uint last = cur->array[cur->curlen - 1];
-  for (uint i = 0; i < cur->curlen - 1; i++) {
-    if (cur->array[i] == last) return false; /* already used */
-  }
+void path_rotate(TSP *tsp, path *p) {
+  assert(tsp && p);
+  assert(p->curlen == tsp->size + 1);
+  path *tmp = path_from_cycle(tsp, p->array, tsp->size);
+  path_copy(tmp, p);
+  path_free(tmp);
+}
 
-  /* check if current path is worst than current solution */
-  if (tsp->options & OPTIMIZE) {
-    if (sol && cur->dist >= sol->dist) return false;
-  }
+/* position of city 0 in a tour, and direction towards its smaller neighbour (1 or n-1) */
+static void path_orient(path *p, uint *start, uint *dir) {
+  uint n = p->curlen - 1;
+  *start = 0;
+  while (p->array[*start] != 0) (*start)++;
+  uint next = p->array[(*start + 1) % n], prev = p->array[(*start + n - 1) % n];
+  *dir = (next <= prev) ? 1 : n - 1;
+}
 
-  return true;
+/* ************************************************************************** */
+
+void path_canonical(path *p) {
+  assert(p);
+  assert(p->curlen >= 2 && p->array[0] == p->array[p->curlen - 1]);
+  uint n = p->curlen - 1, start, dir;
+  path_orient(p, &start, &dir);
+  if (start == 0 && dir == 1) return;
+  uint *tmp = malloc(n * sizeof(uint));
+  assert(tmp);
+  for (uint i = 0; i < n; i++) tmp[i] = p->array[(start + (size_t)i * dir) % n];
+  for (uint i = 0; i < n; i++) p->array[i] = tmp[i];
+  p->array[n] = tmp[0];
+  free(tmp);
 }
 
 /* ************************************************************************** */
 
-uint path_dist(path *p) {
+unsigned long long path_hash(path *p) {
   assert(p);
-  return p->dist;
+  assert(p->curlen >= 2 && p->array[0] == p->array[p->curlen - 1]);
+  uint n = p->curlen - 1, start, dir;
+  path_orient(p, &start, &dir);
+  unsigned long long h = 0xCBF29CE484222325ULL; /* FNV-1a, on the canonical tour */
+  for (uint i = 0; i < n; i++) {
+    h ^= p->array[(start + (size_t)i * dir) % n];
+    h *= 0x100000001B3ULL;
+  }
+  return h;
 }
 
 /* ************************************************************************** */
@@ -143,13 +175,13 @@ uint path_dist(path *p) {
 /* ************************************************************************** */
 
 uint *distmat_random(uint size, uint seed, uint distmax) {
-  srand(seed);
+  unsigned long long state = 0x9E3779B97F4A7C15ULL ^ seed; /* not libc rand, whose sequence is platform-specific */
   // FIXME: correct this function
-  uint *distmat = calloc(size * size, sizeof(uint)); /* memory set to zero */
+  uint *distmat = huge_alloc((size_t)size * size * sizeof(uint), true); /* memory set to zero */
   assert(distmat);
   for (uint i = 0; i < size; i++)
     for (uint j = 0; j < i; j++) {
-      uint dist = (uint)(rand() % distmax) + 1; /* random distance in range [1,distmax] */
+      uint dist = rng_next(&state) % distmax + 1; /* random distance in range [1,distmax] */
       distmat[i * size + j] = distmat[j * size + i] = dist;
     }
   return distmat;
@@ -161,16 +193,23 @@ uint *distmat_load(char *filename, uint *size) {
   assert(filename);
   assert(size);
   FILE *file = fopen(filename, "r");
-  assert(file);
-  fscanf(file, "%u", size);
-  assert(*size > 0);
+  if (!file) file_fail(filename, "cannot read distance matrix");
+  if (fscanf(file, "%u", size) != 1 || *size == 0) file_fail(filename, "bad size of distance matrix");
   // printf("Loading distance matrix of size %u from file \"%s\"\n", *size, filename);
-  uint *distmat = calloc(*size * *size, sizeof(uint)); /* memory set to zero */
+  uint *distmat = huge_alloc((size_t)*size * *size * sizeof(uint), true); /* memory set to zero */
   for (uint i = 0; i < *size; i++)
     for (uint j = 0; j < *size; j++) {
-      uint dist;
-      fscanf(file, "%u", &dist);
-      distmat[i * *size + j] = dist;
+      char token[16];
+      if (fscanf(file, "%15s", token) != 1) file_fail(filename, "truncated distance matrix");
+      if (strcmp(token, "-") == 0) { /* missing arc */
+        distmat[i * *size + j] = DIST_INF;
+        continue;
+      }
+      char *end;
+      unsigned long dist = strtoul(token, &end, 10);
+      if (token[0] < '0' || token[0] > '9' || *end != '\0' || dist >= DIST_INF)
+        file_fail(filename, "bad distance in distance matrix");
+      distmat[i * *size + j] = (uint)dist;
     }
   fclose(file);
   return distmat;
@@ -178,6 +217,42 @@ uint *distmat_load(char *filename, uint *size) {
 
 /* ************************************************************************** */
 
+unsigned long long distmat_hash(uint size, uint *distmat) {
+  assert(distmat);
+  unsigned long long h = 0xCBF29CE484222325ULL; /* FNV-1a */
+  for (size_t i = 0; i < (size_t)size * size; i++) {
+    h ^= distmat[i];
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+/* ************************************************************************** */
+
+void distmat_summary(uint size, uint *distmat) {
+  assert(size >= 2);
+  assert(distmat);
+  uint min = UINT_MAX, max = 0;
+  double sum = 0.0;
+  size_t narcs = 0;
+  bool symmetric = true;
+  for (uint i = 0; i < size; i++)
+    for (uint j = 0; j < size; j++) {
+      if (i == j) continue;
+      uint d = distmat[i * size + j];
+      if (d != distmat[j * size + i]) symmetric = false;
+      if (d == DIST_INF) continue; /* missing arc */
+      narcs++;
+      if (d < min) min = d;
+      if (d > max) max = d;
+      sum += d;
+    }
+  printf("Distance matrix of size %u: %s, %zu arcs, min %u, max %u, mean %.2f, hash %016llx\n", size,
+         symmetric ? "symmetric" : "asymmetric", narcs, min, max, narcs ? sum / narcs : 0.0, distmat_hash(size, distmat));
+}
+
+/* ************************************************************************** */
+
 void distmat_save(uint size, uint *distmat, char *filename) {
   assert(filename);
   assert(size >= 2);
@@ -188,7 +263,8 @@ void distmat_save(uint size, uint *distmat, char *filename) {
   for (uint i = 0; i < size; i++) {
     for (uint j = 0; j < size; j++) {
       uint dist = distmat[i * size + j];
-      fprintf(file, "%u ", dist);
+      if (dist == DIST_INF) fprintf(file, "- ");
+      else fprintf(file, "%u ", dist);
     }
     fprintf(file, "\n");
   }
@@ -200,6 +276,10 @@ void distmat_save(uint size, uint *distmat, char *filename) {
 void distmat_print(uint size, uint *distmat) {
   assert(size >= 2);
   assert(distmat);
+  if (size > 26) { /* city names in range [A,Z] */
+    distmat_summary(size, distmat);
+    return;
+  }
   /* header */
   printf("    ");
   for (uint j = 0; j < size; j++) printf(" %c ", 'A' + j);
@@ -212,7 +292,8 @@ void distmat_print(uint size, uint *distmat) {
   for (uint i = 0; i < size; i++) {
     printf("%c | ", 'A' + i);
     for (uint j = 0; j < size; j++) {
-      printf("%2u ", distmat[i * size + j]);
+      if (distmat[i * size + j] == DIST_INF) printf(" - ");
+      else printf("%2u ", distmat[i * size + j]);
     }
     printf("|\n");
   }
@@ -230,40 +311,307 @@ TSP *tsp_new(uint size, uint first, uint *distmat, unsigned char options) {
   assert(size >= 2);
   assert(first < size);
   assert(distmat);
-  TSP *tsp = malloc(sizeof(TSP));
+  TSP *tsp = calloc(1, sizeof(TSP)); /* other distance sources set to NULL */
   assert(tsp);
   tsp->size = size;
   tsp->first = first;
   tsp->options = options;
   tsp->distmat = distmat;
+  for (size_t i = 0; i < (size_t)size * size && !tsp->missing; i++)
+    tsp->missing = (distmat[i] == DIST_INF && i % (size + 1) != 0);
   return tsp;
 }
 
 /* ************************************************************************** */
 
-void tsp_free(TSP *tsp) { free(tsp); }
+TSP *tsp_new_points(uint size, uint first, double *points, unsigned char options) {
+  assert(points);
+  assert(size >= 2);
+  assert(first < size);
+  TSP *tsp = calloc(1, sizeof(TSP)); /* other distance sources set to NULL */
+  assert(tsp);
+  tsp->size = size;
+  tsp->first = first;
+  tsp->options = options;
+  tsp->points = points;
+  return tsp;
+}
+
+/* ************************************************************************** */
+
+void tsp_free(TSP *tsp) {
+  if (tsp) {
+    free(tsp->search.resume);
+    path_free(tsp->search.incumbent);
+    memo_free(tsp->memo);
+  }
+  free(tsp);
+}
+
+/* ************************************************************************** */
+
+bool tsp_check(TSP *tsp, path *p) {
+  assert(tsp && p);
+  bool open = tsp->options & OPENPATH;
+  if (p->curlen != (open ? tsp->size : tsp->size + 1)) return false;
+  if (p->array[0] != tsp->first || (!open && p->array[tsp->size] != tsp->first)) return false;
+  bool *visited = calloc(tsp->size, sizeof(bool));
+  assert(visited);
+  bool valid = true;
+  for (uint i = 0; i < tsp->size && valid; i++) {
+    uint city = p->array[i];
+    if (city >= tsp->size || visited[city]) valid = false;
+    else visited[city] = true;
+  }
+  free(visited);
+  for (uint i = 0; i + 1 < p->curlen && valid && tsp->missing; i++)
+    valid = (tsp_dist(tsp, p->array[i], p->array[i + 1]) != DIST_INF);
+  if (!valid) return false;
+  uint dist = p->dist;
+  path_update_dist(tsp, p);
+  valid = (p->dist == dist);
+  p->dist = dist;
+  return valid;
+}
+
+/* ************************************************************************** */
+
+void file_fail(char *filename, char *reason) {
+  fprintf(stderr, "Error: %s \"%s\"\n", reason, filename);
+  exit(EXIT_FAILURE);
+}
+
+/* ************************************************************************** */
+/*                              CHECKPOINT                                    */
+/* ************************************************************************** */
+
+#define SEARCH_TICK 0xFFFF /* nb of nodes between two checks of the checkpoint period (minus 1) */
+#define SEARCH_MAGIC "TSPCKPT1"
+#define SEARCH_OPTIONS (OPTIMIZE | BOTTLENECK | OPENPATH) /* options changing the search */
+
+static bool search_write_uint(FILE *file, uint *values, uint n) { return fwrite(values, sizeof(uint), n, file) == n; }
+
+static bool search_read_uint(FILE *file, uint *values, uint n) { return fread(values, sizeof(uint), n, file) == n; }
+
+/* ************************************************************************** */
+
+/* save the search state: the current node is explored again from scratch on resume */
+static void search_save(TSP *tsp, path *cur, path *sol, uint *count, bool done) {
+  search *s = &tsp->search;
+  char tmpname[strlen(s->checkpoint) + 5];
+  sprintf(tmpname, "%s.tmp", s->checkpoint);
+  FILE *file = fopen(tmpname, "wb");
+  if (!file) file_fail(tmpname, "cannot write checkpoint");
+  uint header[5] = {tsp->size, tsp->first, tsp->options & SEARCH_OPTIONS, done, count ? *count : 0};
+  unsigned long long nodes = done ? s->nodes : s->nodes - 1;
+  uint incumbent[2] = {sol->curlen, sol->dist};
+  uint len = done ? 0 : cur->curlen;
+  bool ok = fwrite(SEARCH_MAGIC, 1, 8, file) == 8 && search_write_uint(file, header, 5) &&
+            fwrite(&nodes, sizeof(nodes), 1, file) == 1 && search_write_uint(file, incumbent, 2) &&
+            search_write_uint(file, sol->array, sol->curlen) && search_write_uint(file, &len, 1) &&
+            search_write_uint(file, cur->array, len);
+  if (fclose(file) != 0 || !ok) file_fail(tmpname, "cannot write checkpoint");
+  if (rename(tmpname, s->checkpoint) != 0) file_fail(s->checkpoint, "cannot write checkpoint"); /* never partial */
+  s->last = time(NULL);
+}
+
+/* ************************************************************************** */
+
+/* called every SEARCH_TICK+1 nodes, at the entry of a node */
+static void search_tick(TSP *tsp, path *cur, path *sol, uint *count) {
+  search *s = &tsp->search;
+  bool stop = (s->nodes == s->limit);
+  if (!s->checkpoint) {
+    s->stopped = stop;
+    return;
+  }
+  if (stop || difftime(time(NULL), s->last) >= s->period) search_save(tsp, cur, sol, count, false);
+  s->stopped = stop;
+}
 
 /* ************************************************************************** */
 
-static void tsp_solve_rec(TSP *tsp, path *cur, path *sol, uint *count) {
+/* first city to try from a node: the one of the resumed path along it, then 0 */
+static uint search_resume(TSP *tsp, path *cur) {
+  search *s = &tsp->search;
+  if (!s->resume) return 0;
+  uint depth = cur->curlen;
+  if (depth < s->resumelen && cur->array[depth - 1] == s->resume[depth - 1]) return s->resume[depth];
+  free(s->resume); /* resumed node reached, or left */
+  s->resume = NULL;
+  return 0;
+}
+
+/* ancestor of the resumed node, along the resumed path: already counted and printed before the checkpoint */
+static bool search_replay(TSP *tsp, path *cur) {
+  search *s = &tsp->search;
+  uint depth = cur->curlen;
+  return s->resume && depth < s->resumelen && cur->array[depth - 1] == s->resume[depth - 1];
+}
+
+/* ************************************************************************** */
+
+void tsp_set_checkpoint(TSP *tsp, char *filename, uint period, unsigned long long limit) {
   assert(tsp);
-  if (cur->curlen == tsp->size) return;
-  if (tsp->options & DEBUG) path_print(cur);
-  /* try to extend the current path with all cities */
-  for (uint city = 0; city < tsp->size; city++) {
-    path_push(tsp, cur, city);
-    if (path_check(tsp, cur, sol)) {
-      if (cur->curlen == tsp->size) {
-        path_push(tsp, cur, tsp->first); /* come back to the first city */
-        if (cur->dist < sol->dist) path_copy(cur, sol);
-        if (tsp->options & VERBOSE) path_print(cur);
-        if (count) (*count)++;
-        path_pop(tsp, cur);
-      }
-      tsp_solve_rec(tsp, cur, sol, count);
-    }
-    path_pop(tsp, cur);
+  tsp->search.checkpoint = filename;
+  tsp->search.period = period;
+  tsp->search.limit = limit;
+}
+
+/* ************************************************************************** */
+
+void tsp_resume(TSP *tsp, char *filename) {
+  assert(tsp && filename);
+  search *s = &tsp->search;
+  FILE *file = fopen(filename, "rb");
+  if (!file) file_fail(filename, "cannot read checkpoint");
+  char magic[8];
+  if (fread(magic, 1, 8, file) != 8 || memcmp(magic, SEARCH_MAGIC, 8) != 0) file_fail(filename, "not a checkpoint");
+  uint header[5];
+  if (!search_read_uint(file, header, 5) || header[0] != tsp->size || header[1] != tsp->first ||
+      header[2] != (tsp->options & SEARCH_OPTIONS))
+    file_fail(filename, "checkpoint of another instance or search");
+  s->done = header[3];
+  s->count = header[4];
+  uint incumbent[2];
+  if (fread(&s->nodes, sizeof(s->nodes), 1, file) != 1 || !search_read_uint(file, incumbent, 2) ||
+      incumbent[0] > tsp->size + 1)
+    file_fail(filename, "truncated or corrupted checkpoint");
+  path_free(s->incumbent);
+  s->incumbent = path_new(tsp->size + 1, incumbent[1]);
+  s->incumbent->curlen = incumbent[0];
+  if (!search_read_uint(file, s->incumbent->array, incumbent[0]) || !search_read_uint(file, &s->resumelen, 1) ||
+      s->resumelen > tsp->size)
+    file_fail(filename, "truncated or corrupted checkpoint");
+  free(s->resume);
+  s->resume = malloc((s->resumelen + 1) * sizeof(uint));
+  assert(s->resume);
+  if (!search_read_uint(file, s->resume, s->resumelen)) file_fail(filename, "truncated or corrupted checkpoint");
+  for (uint i = 0; i < incumbent[0]; i++)
+    if (s->incumbent->array[i] >= tsp->size) file_fail(filename, "truncated or corrupted checkpoint");
+  for (uint i = 0; i < s->resumelen; i++)
+    if (s->resume[i] >= tsp->size) file_fail(filename, "truncated or corrupted checkpoint");
+  fclose(file);
+}
+
+/* ************************************************************************** */
+
+bool tsp_stopped(TSP *tsp) {
+  assert(tsp);
+  return tsp->search.stopped;
+}
+
+/* ************************************************************************** */
+
+unsigned long long tsp_nodes(TSP *tsp) {
+  assert(tsp);
+  return tsp->search.nodes;
+}
+
+/* ************************************************************************** */
+/*                            OBJECTIVE POLICIES                              */
+/* ************************************************************************** */
+
+#define OBJ_SUM(acc, d) ((acc) + (d))
+#define OBJ_MAX(acc, d) ((d) > (acc) ? (d) : (acc))
+
+/* the closing edge is known once all cities are visited */
+#define OBJ_CLOSING(tsp, cur, agg) \
+  ((cur)->curlen == (tsp)->size ? agg((cur)->dist, tsp_dist(tsp, (cur)->array[(cur)->curlen - 1], (tsp)->first)) : (cur)->dist)
+
+/* closed tour, min-sum */
+#define OBJ_NAME sum
+#define OBJ_AGG OBJ_SUM
+#define OBJ_INVERTIBLE 1
+#define OBJ_BOUND(tsp, cur) OBJ_CLOSING(tsp, cur, OBJ_SUM)
+#define OBJ_CLOSED 1
+#include "tsp_kernel.h"
+
+/* closed tour, min-max (bottleneck) */
+#define OBJ_NAME max
+#define OBJ_AGG OBJ_MAX
+#define OBJ_INVERTIBLE 0
+#define OBJ_BOUND(tsp, cur) OBJ_CLOSING(tsp, cur, OBJ_MAX)
+#define OBJ_CLOSED 1
+#include "tsp_kernel.h"
+
+/* open path, min-sum */
+#define OBJ_NAME sum_open
+#define OBJ_AGG OBJ_SUM
+#define OBJ_INVERTIBLE 1
+#define OBJ_BOUND(tsp, cur) ((cur)->dist)
+#define OBJ_CLOSED 0
+#include "tsp_kernel.h"
+
+/* open path, min-max (bottleneck) */
+#define OBJ_NAME max_open
+#define OBJ_AGG OBJ_MAX
+#define OBJ_INVERTIBLE 0
+#define OBJ_BOUND(tsp, cur) ((cur)->dist)
+#define OBJ_CLOSED 0
+#include "tsp_kernel.h"
+
+/* ************************************************************************** */
+
+/* aggregates of all prefixes of a path (aggs[k]: aggregate of its first k+1 cities), and its distance */
+static uint *search_aggs(TSP *tsp, path *cur) {
+  uint *aggs = malloc((tsp->size + 1) * sizeof(uint));
+  assert(aggs);
+  uint dist = 0;
+  aggs[0] = 0;
+  for (uint i = 0; i + 1 < cur->curlen; i++) {
+    uint d = tsp_dist(tsp, cur->array[i], cur->array[i + 1]);
+    if (tsp->options & BOTTLENECK) dist = (d > dist) ? d : dist;
+    else dist += d;
+    aggs[i + 1] = dist;
+  }
+  cur->dist = dist;
+  return aggs;
+}
+
+/* ************************************************************************** */
+
+void search_run(TSP *tsp, path *cur, path *sol, uint *count) {
+  assert(tsp && cur && sol);
+  assert(cur->curlen >= 1 && cur->curlen < tsp->size);
+  uint *aggs = search_aggs(tsp, cur);
+  switch (tsp->options & (BOTTLENECK | OPENPATH)) {
+    case 0:
+      tsp_solve_rec_sum(tsp, cur, aggs, sol, count);
+      break;
+    case BOTTLENECK:
+      tsp_solve_rec_max(tsp, cur, aggs, sol, count);
+      break;
+    case OPENPATH:
+      tsp_solve_rec_sum_open(tsp, cur, aggs, sol, count);
+      break;
+    default:
+      tsp_solve_rec_max_open(tsp, cur, aggs, sol, count);
   }
+  free(aggs);
+}
+
+/* ************************************************************************** */
+
+double search_probe(TSP *tsp, path *cur, path *sol, uint *children, unsigned long long *state, double *leaves) {
+  assert(tsp && cur && sol && children && state && leaves);
+  uint *aggs = search_aggs(tsp, cur);
+  double nodes;
+  switch (tsp->options & (BOTTLENECK | OPENPATH)) {
+    case 0:
+      nodes = search_probe_sum(tsp, cur, aggs, sol, children, state, leaves);
+      break;
+    case BOTTLENECK:
+      nodes = search_probe_max(tsp, cur, aggs, sol, children, state, leaves);
+      break;
+    case OPENPATH:
+      nodes = search_probe_sum_open(tsp, cur, aggs, sol, children, state, leaves);
+      break;
+    default:
+      nodes = search_probe_max_open(tsp, cur, aggs, sol, children, state, leaves);
+  }
+  free(aggs);
+  return nodes;
 }
 
 /* ************************************************************************** */
@@ -272,8 +620,31 @@ path *tsp_solve(TSP *tsp, uint *count) {
   assert(tsp);
   path *cur = path_new(tsp->size + 1, 0);
   path *sol = path_new(tsp->size + 1, UINT_MAX);
-  path_push(tsp, cur, tsp->first);
-  tsp_solve_rec(tsp, cur, sol, count);
+  cur->array[cur->curlen++] = tsp->first;
+  search *s = &tsp->search;
+  s->stopped = false;
+  s->last = time(NULL);
+  if (s->incumbent) {
+    path_copy(s->incumbent, sol);
+    if (count) *count += s->count;
+  }
+  if (s->done) {
+    path_free(cur);
+    return sol;
+  }
+  bool warm = tsp->elite && !(tsp->options & OPENPATH);
+  path *best = warm ? elite_best(tsp->elite) : NULL;
+  if (best && best->dist < sol->dist && best->dist < UINT_MAX) {
+    /* warm start, bounded one above its distance so that the lexicographically smallest optimal tour is
+     * still found by the search, maybe this one again */
+    path_copy(best, sol);
+    sol->dist++;
+  }
+  path_free(best);
+  search_run(tsp, cur, sol, count);
+  if (sol->curlen > 0) path_update_dist(tsp, sol); /* true distance of a warm start tour not found again */
+  if (s->checkpoint && !s->stopped) search_save(tsp, cur, sol, count, true);
+  if (warm && sol->curlen > 0) elite_insert(tsp->elite, sol);
   path_free(cur);
   return sol;
 }
@@ -9,14 +9,44 @@
 #ifndef TSP_H
 #define TSP_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 /* ************************************************************************** */
 /*                                 TYPES                                      */
 /* ************************************************************************** */
 
 typedef unsigned int uint;
-enum { NONE = 0, VERBOSE = 1, DEBUG = 2, OPTIMIZE = 4 };
+#define DIST_INF ((uint)-1) /* missing arc in a distance matrix ("-" in files) */
+enum { NONE = 0, VERBOSE = 1, DEBUG = 2, OPTIMIZE = 4, BOTTLENECK = 8, OPENPATH = 16 };
 typedef struct TSP TSP;
 typedef struct path path;
+typedef struct cand cand;
+typedef struct elite elite;
+typedef struct trace trace;
+typedef struct tsp_iter tsp_iter;
+typedef struct memo memo;
+typedef struct profile profile;
+enum { HUGE_OFF = 0, HUGE_TRANSPARENT = 1, HUGE_EXPLICIT = 2 }; /* huge page modes of large buffers */
+typedef uint (*distfn)(uint i, uint j, void *data); /* user distance callback */
+
+/* estimated size and run time of the exact search, with 95% confidence intervals */
+typedef struct estimate {
+  double nodes, nodes_low, nodes_high;       /* nb of search nodes */
+  double seconds, seconds_low, seconds_high; /* run time */
+  double paths;                              /* nb of complete paths reached */
+  double rate;                               /* nb of nodes per second */
+} estimate;
+
+/* page sizes and huge page usage of large buffers, since the start of the process */
+typedef struct pagestats {
+  uint mode;                   /* huge page mode */
+  size_t pagesize, hugesize;   /* normal and huge page sizes, in bytes */
+  unsigned long long advised;  /* bytes advised for transparent huge pages */
+  unsigned long long mapped;   /* bytes mapped on explicit huge pages */
+  unsigned long long fallback; /* bytes requested on explicit huge pages, but advised instead */
+  unsigned long long backed;   /* bytes currently backed by transparent huge pages */
+} pagestats;
 
 /* ************************************************************************** */
 /*                                    PATH                                    */
@@ -41,6 +71,13 @@ void path_free(path *p);
  */
 void path_print(path *p);
 
+/**
+ * @brief Save a path in a file: its length and distance, then one city per line.
+ * @param p path
+ * @param filename filename (or "-" for standard output)
+ */
+void path_save(path *p, char *filename);
+
 /**
  * @brief Compute the distance of a path.
  * @param p path
@@ -48,12 +85,34 @@ void path_print(path *p);
  */
 uint path_dist(path *p);
 
+/**
+ * @brief Check if two paths have the same cities in the same order.
+ * @param p path
+ * @param q path
+ * @return bool true if equal
+ */
+bool path_equal(path *p, path *q);
+
+/**
+ * @brief Normalize a tour, the same for all its rotations and reflections: rotate it to start from
+ * city 0, in the direction of the smaller neighbour of city 0.
+ * @param p tour (with the first city repeated at the end)
+ */
+void path_canonical(path *p);
+
+/**
+ * @brief Hash a tour, the same for all its rotations and reflections (without normalizing it).
+ * @param p tour (with the first city repeated at the end)
+ * @return unsigned long long 64-bit hash
+ */
+unsigned long long path_hash(path *p);
+
 /* ************************************************************************** */
 /*                              DISTANCE MATRIX                               */
 /* ************************************************************************** */
 
 /**
- * @brief Create a random distance matrix.
+ * @brief Create a random distance matrix, the same for a given seed on all platforms.
  *
  * @param size problem size
  * @param seed random seed
@@ -70,6 +129,47 @@ uint *distmat_random(uint size, uint seed, uint distmax);
  */
 void distmat_print(uint size, uint *distmat);
 
+/**
+ * @brief Print a summary of a distance matrix: size, min, max and mean distances, symmetry, hash.
+ * Distance matrices of more than 26 cities are always printed this way.
+ *
+ * @param size problem size
+ * @param distmat distance matrix
+ */
+void distmat_summary(uint size, uint *distmat);
+
+/**
+ * @brief Compute a 64-bit hash of a distance matrix, to identify an instance.
+ *
+ * @param size problem size
+ * @param distmat distance matrix
+ * @return unsigned long long hash
+ */
+unsigned long long distmat_hash(uint size, uint *distmat);
+
+/**
+ * @brief Compute the shortest path closure of a distance matrix with missing (DIST_INF) or non-shortest
+ * arcs, with parallel Dijkstra from each city for sparse matrices, or a cache-blocked parallel
+ * Floyd-Warshall otherwise. The closure is metric. The matrix must be strongly connected: otherwise, exit
+ * with an error message.
+ *
+ * @param size problem size
+ * @param distmat distance matrix
+ * @param next first city after i on the shortest path from i to j, at next[i*size+j] (output, or NULL)
+ * @return uint* shortest path distance matrix
+ */
+uint *distmat_closure(uint size, uint *distmat, uint *next);
+
+/**
+ * @brief Expand a path on a shortest path closure into the path of the original arcs.
+ *
+ * @param p path (on the closure)
+ * @param size problem size
+ * @param next first cities of shortest paths (from distmat_closure)
+ * @return path* expanded path, with the same distance
+ */
+path *path_expand(path *p, uint size, uint *next);
+
 /**
  * @brief Load a distance matrix from a file.
  *
@@ -87,12 +187,64 @@ uint *distmat_load(char *filename, uint *size);
  */
 void distmat_save(uint size, uint *distmat, char *filename);
 
+/* ************************************************************************** */
+/*                                  POINTS                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Create random city coordinates, uniform in the square [0,max[ x [0,max[, the same for a given seed
+ * on all platforms.
+ *
+ * @param size problem size
+ * @param seed random seed
+ * @param max max coordinate
+ * @return double* coordinates (x0, y0, x1, y1, ...)
+ */
+double *points_random(uint size, uint seed, uint max);
+
+/**
+ * @brief Load city coordinates from a file (size, then one "x y" line per city).
+ *
+ * @param filename filename
+ * @param size problem size (output)
+ * @return double* coordinates (x0, y0, x1, y1, ...)
+ */
+double *points_load(char *filename, uint *size);
+
+/**
+ * @brief Save city coordinates to a file.
+ * @param size problem size
+ * @param points coordinates
+ * @param filename filename
+ */
+void points_save(uint size, double *points, char *filename);
+
+/**
+ * @brief Print a summary of city coordinates: size, bounding box, hash.
+ * @param size problem size
+ * @param points coordinates
+ */
+void points_summary(uint size, double *points);
+
+/**
+ * @brief Load a TSPLIB file (TSP or ATSP): city coordinates for EUC_2D weights (rounded euclidean distances,
+ * as tsp_new_points), or a distance matrix for EXPLICIT weights (FULL_MATRIX, or UPPER/LOWER_ROW and
+ * UPPER/LOWER_DIAG_ROW for symmetric ones).
+ * @param filename filename
+ * @param size problem size (output)
+ * @param distmat distance matrix, or NULL (output)
+ * @param points coordinates (x0, y0, x1, y1, ...), or NULL (output)
+ */
+void tsplib_load(char *filename, uint *size, uint **distmat, double **points);
+
 /* ************************************************************************** */
 /*                                    TSP                                     */
 /* ************************************************************************** */
 
 /**
- * @brief Create a new TSP instance.
+ * @brief Create a new TSP instance. Missing arcs (DIST_INF) are never used by the exact engines (tsp_solve,
+ * tsp_solve_parallel, tsp_iter and tsp_estimate), which find no tour if they leave none. Heuristics need all
+ * arcs: give them the shortest path closure (distmat_closure) instead.
  * @param size problem size
  * @param first first city
  * @param distmat distance matrix
@@ -101,7 +253,65 @@ void distmat_save(uint size, uint *distmat, char *filename);
 TSP *tsp_new(uint size, uint first, uint *distmat, unsigned char options);
 
 /**
- * @brief Solve the TSP problem.
+ * @brief Create a new geometric TSP instance, with rounded euclidean distances computed on the fly.
+ * @param size problem size
+ * @param first first city
+ * @param points city coordinates
+ * @param options options: verbose, debug, optimize, ...
+ */
+TSP *tsp_new_points(uint size, uint first, double *points, unsigned char options);
+
+/**
+ * @brief Create a new TSP instance whose distances come from a user callback, such as an expensive routing
+ * engine. Distances are fetched lazily, only for the pairs used by engines, and memoized in a concurrent
+ * cache, so that memory and callback calls scale with these pairs instead of all n² ones. Nearest neighbour
+ * candidate lists are the exception: without a hint (see tsp_set_hint), they need one scan of all pairs
+ * (n(n-1)/2 calls if symmetric, n(n-1) otherwise, for both successors and predecessors). The callback must
+ * be thread-safe.
+ *
+ * @param size problem size
+ * @param first first city
+ * @param fn distance callback
+ * @param data user data passed to the callback
+ * @param symmetric true if the distances are symmetric, so that (i,j) and (j,i) need a single call
+ * @param options options: verbose, debug, optimize, ...
+ */
+TSP *tsp_new_callback(uint size, uint first, distfn fn, void *data, bool symmetric, unsigned char options);
+
+/**
+ * @brief Give approximate coordinates of the cities of a callback instance (such as the geographic positions
+ * behind road distances), before any engine runs: the candidate lists of a city are then its k nearest by
+ * callback distance among its 3k nearest by hint, so that they need about 3kn callback calls instead of a
+ * scan of all pairs. Lists are exact if the hint ranks neighbours as the callback does.
+ *
+ * @param tsp  callback instance
+ * @param points  approximate city coordinates, which must outlive the instance
+ */
+void tsp_set_hint(TSP *tsp, double *points);
+
+/**
+ * @brief Fetch the distances of a batch of pairs in parallel into the memo cache of a callback instance,
+ * before engines use them (nothing for other instances).
+ *
+ * @param tsp  TSP instance
+ * @param pairs  pairs of cities (i0, j0, i1, j1, ...)
+ * @param npairs  nb of pairs
+ */
+void tsp_prefetch(TSP *tsp, uint *pairs, size_t npairs);
+
+/**
+ * @brief Get the statistics of the memo cache of a callback instance (zero for other instances).
+ *
+ * @param tsp  TSP instance
+ * @param calls  nb of callback calls (output)
+ * @param pairs  nb of pairs memoized (output)
+ */
+void tsp_memo_stats(TSP *tsp, unsigned long long *calls, unsigned long long *pairs);
+
+/**
+ * @brief Solve the TSP problem. The objective is a closed tour of min total distance, or of min
+ * longest edge with the BOTTLENECK option, or an open path (not coming back to the first city)
+ * with the OPENPATH option; each objective has its own specialized search.
  *
  * @param tsp  TSP instance
  * @param count  number of solutions
@@ -116,6 +326,533 @@ path *tsp_solve(TSP *tsp, uint *count);
  */
 void tsp_free(TSP *tsp);
 
+/**
+ * @brief Solve the TSP problem with a deterministic parallel search: the search tree is split into a
+ * fixed set of subtrees, explored in parallel by epochs that share the incumbent bound only at their
+ * end. Among optimal tours, the lexicographically smallest is returned, as by tsp_solve, even when warm
+ * started from the elite pool. The tour and count are the same for any nb of threads (count may differ
+ * from tsp_solve, as pruning differs).
+ *
+ * @param tsp  TSP instance (without checkpoint)
+ * @param count  number of solutions
+ * @return path*  best tour
+ */
+path *tsp_solve_parallel(TSP *tsp, uint *count);
+
+/**
+ * @brief Create an iterator over all complete tours (or paths) of a TSP instance, in the order of the
+ * exact search without pruning. The search state is an explicit stack, so it can be suspended between
+ * any two tours.
+ *
+ * @param tsp  TSP instance
+ * @return tsp_iter*  iterator
+ */
+tsp_iter *tsp_iter_new(TSP *tsp);
+
+/**
+ * @brief Free an iterator.
+ * @param it  iterator
+ */
+void tsp_iter_free(tsp_iter *it);
+
+/**
+ * @brief Get the next tour of an iterator, with its distance.
+ *
+ * @param it  iterator
+ * @param p  path of max length at least size+1, set to the next tour (output)
+ * @return bool  false if all tours have been enumerated
+ */
+bool tsp_iter_next(tsp_iter *it, path *p);
+
+/**
+ * @brief Enumerate all tours in a binary file: a header ("TSPTOUR1" and the nb of cities per record
+ * as 32-bit integer), then fixed-size records of the distance (32 bits) followed by the cities (16 bits
+ * each), in native byte order.
+ *
+ * @param tsp  TSP instance
+ * @param filename  output file
+ * @return unsigned long long  nb of tours
+ */
+unsigned long long tsp_iter_save(TSP *tsp, char *filename);
+
+/**
+ * @brief Estimate the size and run time of the exact search (tsp_solve), with random probes from the
+ * root to a leaf through the children passing the real checks (Knuth). With the OPTIMIZE option, the
+ * pruning bound is a heuristic tour (or the best one of the elite pool) as if it were found first, while
+ * the real search starts without bound but then finds better tours. The speed is measured on the first
+ * nodes of the real search; if it completes meanwhile, the estimate is exact.
+ *
+ * @param tsp  TSP instance
+ * @param probes  nb of probes (at least 2)
+ * @param seed  random seed
+ * @param est  estimate (output)
+ */
+void tsp_estimate(TSP *tsp, uint probes, uint seed, estimate *est);
+
+/**
+ * @brief Enable checkpoints of the exact search (tsp_solve): its state is saved periodically in a
+ * file, from which a later search can be resumed with tsp_resume. The last checkpoint marks the
+ * search as completed.
+ *
+ * @param tsp  TSP instance
+ * @param filename  checkpoint file
+ * @param period  min nb of seconds between two checkpoints
+ * @param limit  max nb of search nodes, then the search stops after a checkpoint (or 0)
+ */
+void tsp_set_checkpoint(TSP *tsp, char *filename, uint period, unsigned long long limit);
+
+/**
+ * @brief Resume the next exact search (tsp_solve) from a checkpoint of the same instance and options.
+ * The search returns the same tour and count as if it had never been interrupted.
+ *
+ * @param tsp  TSP instance
+ * @param filename  checkpoint file
+ */
+void tsp_resume(TSP *tsp, char *filename);
+
+/**
+ * @brief Check if the last exact search stopped at its node limit, before completion.
+ *
+ * @param tsp  TSP instance
+ * @return bool  true if stopped
+ */
+bool tsp_stopped(TSP *tsp);
+
+/**
+ * @brief Nb of search nodes explored by the exact searches of an instance, a machine-independent measure of
+ * their work: accumulated over all calls of tsp_solve and tsp_solve_parallel (summed over all threads),
+ * from the resumed checkpoint if any.
+ *
+ * @param tsp  TSP instance
+ * @return unsigned long long  nb of nodes
+ */
+unsigned long long tsp_nodes(TSP *tsp);
+
+/**
+ * @brief Check that a path is a complete tour from the first city, with a correct distance.
+ *
+ * @param tsp  TSP instance
+ * @param p  path
+ * @return bool  true if valid
+ */
+bool tsp_check(TSP *tsp, path *p);
+
+/**
+ * @brief Check if the distances of a TSP instance are symmetric.
+ *
+ * @param tsp  TSP instance
+ * @return bool  true if symmetric
+ */
+bool tsp_symmetric(TSP *tsp);
+
+/**
+ * @brief Create the symmetric instance of 2n cities equivalent to an asymmetric instance of n cities
+ * (Jonker-Volgenant): city i becomes an in-node i and an out-node i+n, joined by a ghost edge of cost 0,
+ * and arc (i,j) becomes edge (i+n,j). Distances are computed on the fly from the asymmetric instance,
+ * which must outlive it. Symmetric engines (2-opt, ...) can then run on asymmetric instances.
+ *
+ * @param asym  asymmetric TSP instance
+ * @return TSP*  symmetric TSP instance, starting from the in-node of the first city
+ */
+TSP *tsp_new_sym(TSP *asym);
+
+/**
+ * @brief Map a tour of an asymmetric instance to its symmetric instance.
+ *
+ * @param sym  symmetric TSP instance (from tsp_new_sym)
+ * @param p  asymmetric tour
+ * @return path*  symmetric tour
+ */
+path *path_to_sym(TSP *sym, path *p);
+
+/**
+ * @brief Map a tour of a symmetric instance back to its asymmetric instance.
+ *
+ * @param sym  symmetric TSP instance (from tsp_new_sym)
+ * @param p  symmetric tour, using all ghost edges
+ * @return path*  asymmetric tour
+ */
+path *path_from_sym(TSP *sym, path *p);
+
+/* ************************************************************************** */
+/*                               HEURISTICS                                   */
+/* ************************************************************************** */
+
+/* Heuristics build and improve closed tours of min total distance: they ignore the BOTTLENECK and OPENPATH
+ * options of the instance. */
+
+/**
+ * @brief Compute the k nearest neighbours of each city (using a kd-tree for geometric instances).
+ *
+ * @param tsp  TSP instance
+ * @param k  nb of neighbours per city
+ * @return cand*  candidate lists
+ */
+cand *cand_knn(TSP *tsp, uint k);
+
+/**
+ * @brief Compute the Delaunay triangulation of a geometric instance in O(n log n) (Guibas-Stolfi divide and
+ * conquer), as a sparse candidate graph of about 6 neighbours per city, which almost always contains the
+ * edges of optimal tours. Cities at the same place are only linked to the first one.
+ *
+ * @param tsp  geometric TSP instance
+ * @return cand*  candidate lists, sorted by increasing distance
+ */
+cand *cand_delaunay(TSP *tsp);
+
+/**
+ * @brief Compute the k alpha-nearest neighbours of each city, for symmetric instances (Helsgaun): the alpha of
+ * an edge is the increase of the minimum 1-tree length when this edge is forced in, computed for all edges in
+ * O(n²) overall. Distances can first be penalized by a subgradient ascent of the Held-Karp bound, so that the
+ * 1-tree gets closer to a tour. Alpha-nearest neighbours contain more optimal tour edges than nearest ones,
+ * so that fewer candidates per city are needed.
+ *
+ * @param tsp  symmetric TSP instance
+ * @param k  nb of neighbours per city
+ * @param ascent  nb of subgradient iterations, each computing a 1-tree in O(n²) (or 0 for plain distances)
+ * @return cand*  candidate lists of the k smallest alphas, sorted by increasing distance
+ */
+cand *cand_alpha(TSP *tsp, uint k, uint ascent);
+
+/**
+ * @brief Share candidate lists with all local search engines of a TSP instance (2-opt, greedy, spatial
+ * partitioning, ...), instead of the nearest neighbours they compute otherwise.
+ *
+ * @param tsp  TSP instance
+ * @param c  candidate lists, which must outlive their use (or NULL)
+ */
+void tsp_set_cand(TSP *tsp, cand *c);
+
+/**
+ * @brief Free candidate lists.
+ * @param c  candidate lists
+ */
+void cand_free(cand *c);
+
+/**
+ * @brief Get the total nb of candidates, over all cities (twice the nb of edges for symmetric lists).
+ * @param c  candidate lists
+ * @return uint  nb of candidates
+ */
+uint cand_size(cand *c);
+
+/**
+ * @brief Build a tour with the nearest neighbour heuristic.
+ *
+ * @param tsp  TSP instance
+ * @return path*  tour
+ */
+path *tsp_nearest(TSP *tsp);
+
+/**
+ * @brief Build a tour with the greedy edge heuristic on candidate edges, for symmetric instances: the
+ * shortest edges are added first unless they make a city of degree 3 or close a cycle, then the fragments
+ * are joined by their nearest endpoints.
+ *
+ * @param tsp  TSP instance
+ * @param c  candidate lists (or NULL for the shared ones of tsp_set_cand if any, else the Delaunay graph
+ * of geometric instances, else the 8 nearest neighbours)
+ * @return path*  tour
+ */
+path *tsp_greedy(TSP *tsp, cand *c);
+
+/**
+ * @brief Build a random tour.
+ *
+ * @param tsp  TSP instance
+ * @param seed  random seed
+ * @return path*  tour
+ */
+path *tsp_random(TSP *tsp, uint seed);
+
+/**
+ * @brief Improve a tour in place with 2-opt moves, for symmetric instances.
+ *
+ * @param tsp  TSP instance
+ * @param p  tour
+ * @param c  candidate lists (or NULL for the shared ones of tsp_set_cand if any, else the 8 nearest neighbours)
+ */
+void tsp_2opt(TSP *tsp, path *p, cand *c);
+
+/**
+ * @brief Improve a tour in place with guided local search, for symmetric instances: 2-opt runs on distances
+ * augmented by penalties, and at each local optimum the tour edges of max utility (distance / (1 + penalty))
+ * are penalized, to drive the search away from it. Penalties are only stored for the edges ever penalized.
+ * The best tour on real distances is kept.
+ *
+ * @param tsp  TSP instance
+ * @param p  tour
+ * @param c  candidate lists (or NULL for the shared ones of tsp_set_cand if any, else the 8 nearest neighbours)
+ * @param iterations  nb of penalized local optima
+ */
+void tsp_gls(TSP *tsp, path *p, cand *c, uint iterations);
+
+/**
+ * @brief Improve a tour in place by large neighbourhood search: a few related cities are removed, either the
+ * nearest ones of a random city through candidate lists or a tour segment, and reinserted optimally by the exact
+ * search, which reconnects them with the tour fragments left between them (kept in their direction, so that
+ * asymmetric instances are valid too). Improvements are accepted only. Each round solves several operations on
+ * disjoint regions in parallel, with the same result for any nb of threads.
+ *
+ * @param tsp  TSP instance
+ * @param p  tour
+ * @param c  candidate lists (or NULL for the shared ones of tsp_set_cand if any, else the 8 nearest neighbours)
+ * @param removed  nb of cities removed by each operation (at least 2, at most 9 and half the cities, fewer if they
+ * are scattered)
+ * @param iterations  nb of destroy and repair operations
+ * @param seed  seed of the random choice of cities
+ */
+void tsp_lns(TSP *tsp, path *p, cand *c, uint removed, uint iterations, unsigned long long seed);
+
+/**
+ * @brief Improve a tour in place with reversal-free moves, for asymmetric instances (also valid on symmetric
+ * ones): or-opt moves a segment of at most 3 cities elsewhere, and or-3opt exchanges two adjacent segments,
+ * both keeping the orientation of all segments so that gains are computed in O(1). Moves start from new arcs
+ * to the out-candidates of a city, or from the in-candidates of a city.
+ *
+ * @param tsp  TSP instance
+ * @param p  tour
+ * @param out  nearest successors of each city (or NULL for the shared ones of tsp_set_cand if any, else the 8
+ * nearest successors)
+ * @param in  nearest predecessors of each city (or NULL for the 8 nearest predecessors)
+ */
+void tsp_or3opt(TSP *tsp, path *p, cand *out, cand *in);
+
+/**
+ * @brief Solve a geometric TSP by spatial partitioning (Karp): the plane is split recursively into
+ * cells of at most cellmax cities, solved in parallel, then stitched together and improved by 2-opt
+ * around the joins.
+ *
+ * @param tsp  geometric TSP instance
+ * @param cellmax  max nb of cities per cell
+ * @return path*  tour
+ */
+path *tsp_solve_karp(TSP *tsp, uint cellmax);
+
+/**
+ * @brief Improve a tour in place with POPMUSIC: the tour is cut into parts of psize consecutive
+ * cities, and each sub-path made of r consecutive parts around a seed part is optimized (exactly if
+ * small enough), until no sub-problem improves. Sub-problems far apart in the tour run in parallel.
+ *
+ * @param tsp  TSP instance
+ * @param p  tour
+ * @param psize  nb of cities per part
+ * @param r  nb of parts per sub-problem
+ */
+void tsp_popmusic(TSP *tsp, path *p, uint psize, uint r);
+
+/**
+ * @brief Merge a pool of good tours: search exactly the best tour using only edges of the pool
+ * tours, with the edges common to all of them (backbone) fixed. The best pool tour is the initial
+ * incumbent, so the result is never worse. Each search is capped at 10 million nodes: when the cap is
+ * hit, the result is the best tour found so far, not necessarily the best one of the union graph.
+ *
+ * @param tsp  TSP instance
+ * @param tours  pool of tours
+ * @param ntours  nb of tours
+ * @param count  nb of complete tours explored (output, or NULL)
+ * @return path*  best tour
+ */
+path *tsp_solve_merge(TSP *tsp, path **tours, uint ntours, uint *count);
+
+/* ************************************************************************** */
+/*                                ELITE POOL                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Create an elite pool, keeping the best distinct tours of a TSP instance (with a closed
+ * tour objective). Pools are thread-safe, and shared by all engines of an instance once set with
+ * tsp_set_elite.
+ *
+ * @param tsp  TSP instance
+ * @param capacity  max nb of tours
+ * @return elite*  elite pool
+ */
+elite *elite_new(TSP *tsp, uint capacity);
+
+/**
+ * @brief Free an elite pool and its tours.
+ * @param e  elite pool
+ */
+void elite_free(elite *e);
+
+/**
+ * @brief Insert a copy of a tour into an elite pool, unless it is already there (in any rotation or
+ * direction), or worse than all tours of a full pool. In a full pool, the most similar tour (most
+ * common edges) among the worse ones is replaced, to keep the pool diverse.
+ *
+ * @param e  elite pool
+ * @param p  tour
+ * @return bool  true if inserted
+ */
+bool elite_insert(elite *e, path *p);
+
+/**
+ * @brief Copy the best tours of an elite pool, by increasing distance.
+ *
+ * @param e  elite pool
+ * @param tours  array of at least max tours, set to new paths (output)
+ * @param max  max nb of tours
+ * @return uint  nb of tours copied
+ */
+uint elite_snapshot(elite *e, path **tours, uint max);
+
+/**
+ * @brief Copy the best tour of an elite pool.
+ *
+ * @param e  elite pool
+ * @return path*  best tour (or NULL if empty)
+ */
+path *elite_best(elite *e);
+
+/**
+ * @brief Share an elite pool with all engines of a TSP instance: heuristics insert their tours, tour
+ * merging also merges its tours, and exact searches start from its best tour and insert their solution.
+ *
+ * @param tsp  TSP instance
+ * @param e  elite pool (or NULL)
+ */
+void tsp_set_elite(TSP *tsp, elite *e);
+
+/* ************************************************************************** */
+/*                                  TRACE                                     */
+/* ************************************************************************** */
+
+/**
+ * @brief Create a binary trace file for the exact search of an instance: with tsp_set_trace, debug
+ * and verbose prints are replaced by fixed-size records, buffered per thread and written by blocks.
+ *
+ * @param filename  trace file
+ * @param size  problem size
+ * @param sample  record only one node every sample nodes (1 for all)
+ * @param maxdepth  record only nodes with at most maxdepth cities (or 0 for all)
+ * @return trace*  trace
+ */
+trace *trace_new(char *filename, uint size, uint sample, uint maxdepth);
+
+/**
+ * @brief Write all buffered records, and close a trace file.
+ * @param tr  trace
+ */
+void trace_free(trace *tr);
+
+/**
+ * @brief Trace the exact search of a TSP instance, instead of printing it in debug and verbose modes.
+ *
+ * @param tsp  TSP instance
+ * @param tr  trace (or NULL to print)
+ */
+void tsp_set_trace(TSP *tsp, trace *tr);
+
+/**
+ * @brief Decode a trace file and print it as the debug and verbose prints it replaces.
+ * @param filename  trace file
+ */
+void trace_print(char *filename);
+
+/* ************************************************************************** */
+/*                                 PROFILE                                    */
+/* ************************************************************************** */
+
+/**
+ * @brief Create an anytime profile, whose clock starts now: once set with tsp_set_profile, engines record
+ * the distance of each new incumbent tour with its time, so that runs are compared over time rather than
+ * on their final tour only. Profiles are thread-safe.
+ *
+ * @return profile*  profile
+ */
+profile *profile_new(void);
+
+/**
+ * @brief Free an anytime profile.
+ * @param pr  profile
+ */
+void profile_free(profile *pr);
+
+/**
+ * @brief Seconds elapsed since the profile was created.
+ * @param pr  profile
+ * @return double  seconds
+ */
+double profile_elapsed(profile *pr);
+
+/**
+ * @brief Record an incumbent distance at the current time, unless not better than the last one.
+ * @param pr  profile
+ * @param dist  tour distance
+ */
+void profile_record(profile *pr, uint dist);
+
+/**
+ * @brief Nb of incumbents recorded in a profile, by decreasing distance.
+ * @param pr  profile
+ * @return uint  nb of points
+ */
+uint profile_len(profile *pr);
+
+/**
+ * @brief Get an incumbent of a profile.
+ *
+ * @param pr  profile
+ * @param i  index of the point, from 0 to profile_len - 1
+ * @param time  seconds since the profile was created (output, or NULL)
+ * @param dist  tour distance (output, or NULL)
+ */
+void profile_point(profile *pr, uint i, double *time, uint *dist);
+
+/**
+ * @brief Distance of the incumbent of a profile at a given time.
+ *
+ * @param pr  profile
+ * @param time  seconds since the profile was created
+ * @return uint  tour distance (or UINT_MAX if no tour yet)
+ */
+uint profile_at(profile *pr, double time);
+
+/**
+ * @brief Time to target: time of the first incumbent of a profile at most a given distance.
+ *
+ * @param pr  profile
+ * @param target  tour distance
+ * @return double  seconds since the profile was created (or -1 if never reached)
+ */
+double profile_time_to(profile *pr, uint target);
+
+/**
+ * @brief Record the incumbents of all engines of a TSP instance in an anytime profile: heuristics report
+ * their improved tours, and exact searches each new best complete path.
+ *
+ * @param tsp  TSP instance
+ * @param pr  profile (or NULL)
+ */
+void tsp_set_profile(TSP *tsp, profile *pr);
+
+/* ************************************************************************** */
+/*                                HUGE PAGES                                  */
+/* ************************************************************************** */
+
+/**
+ * @brief Set how large buffers (distance matrices, candidate lists, memo caches) are allocated, from
+ * the next allocation on: on normal pages only (HUGE_OFF), on pages advised for transparent huge pages
+ * (HUGE_TRANSPARENT, the default), or on explicit huge pages of the pool reserved by the system
+ * (HUGE_EXPLICIT), falling back to transparent ones when the pool is empty. Distance matrices returned
+ * by distmat functions are never mapped explicitly, and are still freed with free().
+ *
+ * @param mode  HUGE_OFF, HUGE_TRANSPARENT or HUGE_EXPLICIT
+ */
+void huge_set_mode(uint mode);
+
+/**
+ * @brief Get the page sizes and the huge page usage of large buffers, for run reports.
+ * @param st  statistics (output)
+ */
+void huge_stats(pagestats *st);
+
+/**
+ * @brief Print the page sizes and the huge page usage of large buffers.
+ */
+void huge_summary(void);
+
 /* ************************************************************************** */
 
 #endif
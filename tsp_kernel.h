@@ -0,0 +1,139 @@
+/**
+ * @file tsp_kernel.h
+ * @brief Exact search kernel, specialized for an objective policy at compile time.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ * This file is included once per objective (no include guard), with the following macros defined:
+ *  - OBJ_NAME: suffix of the generated functions (sum, max, ...)
+ *  - OBJ_AGG(acc, d): aggregate of a path distance acc with one more edge of distance d
+ *  - OBJ_INVERTIBLE: 1 if the last edge can be removed by subtraction, 0 to restore the aggregate of the
+ *    shorter path from the per-depth aggregates aggs (aggs[k]: aggregate of the first k+1 cities)
+ *  - OBJ_BOUND(tsp, cur): lower bound of any complete path extending cur
+ *  - OBJ_CLOSED: 1 if the path comes back to the first city, 0 for an open path
+ *
+ * All macros are undefined at the end of the file.
+ **/
+
+#define KERNEL_CAT2(name, suffix) name##_##suffix
+#define KERNEL_CAT(name, suffix) KERNEL_CAT2(name, suffix)
+#define KERNEL(name) KERNEL_CAT(name, OBJ_NAME)
+
+/* ************************************************************************** */
+
+static void KERNEL(path_push)(TSP *tsp, path *p, uint *aggs, uint city) {
+  assert(p->curlen < p->maxlen);
+  assert(city < tsp->size);
+  if (p->curlen > 0) p->dist = OBJ_AGG(p->dist, tsp_dist(tsp, p->array[p->curlen - 1], city));
+#if !OBJ_INVERTIBLE
+  aggs[p->curlen] = p->dist;
+#endif
+  p->array[p->curlen++] = city;
+}
+
+/* ************************************************************************** */
+
+static void KERNEL(path_pop)(TSP *tsp, path *p, uint *aggs) {
+  assert(p->curlen > 0);
+  p->curlen--;
+#if OBJ_INVERTIBLE
+  if (p->curlen > 0) p->dist -= tsp_dist(tsp, p->array[p->curlen - 1], p->array[p->curlen]);
+#else
+  if (p->curlen > 0) p->dist = aggs[p->curlen - 1];
+#endif
+}
+
+/* ************************************************************************** */
+
+static bool KERNEL(path_check)(TSP *tsp, path *cur, path *sol) {
+  /* check if current path is invalid */
+  if (cur->curlen <= 1) return true;
+  uint last = cur->array[cur->curlen - 1];
+  for (uint i = 0; i < cur->curlen - 1; i++) {
+    if (cur->array[i] == last) return false; /* already used */
+  }
+
+  /* check if an arc of the current path is missing, the closing one once all cities are visited */
+  if (tsp->missing) {
+    if (tsp_dist(tsp, cur->array[cur->curlen - 2], last) == DIST_INF) return false;
+#if OBJ_CLOSED
+    if (cur->curlen == tsp->size && tsp_dist(tsp, last, tsp->first) == DIST_INF) return false;
+#endif
+  }
+
+  /* check if current path is worst than current solution */
+  if (tsp->options & OPTIMIZE) {
+    if (sol && OBJ_BOUND(tsp, cur) >= sol->dist) return false;
+  }
+
+  return true;
+}
+
+/* ************************************************************************** */
+
+static void KERNEL(tsp_solve_rec)(TSP *tsp, path *cur, uint *aggs, path *sol, uint *count) {
+  if (cur->curlen == tsp->size) return;
+  bool replay = search_replay(tsp, cur);
+  if (!replay && ((++tsp->search.nodes & SEARCH_TICK) == 0 || tsp->search.nodes == tsp->search.limit))
+    search_tick(tsp, cur, sol, count);
+  if (tsp->search.stopped) return;
+  if ((tsp->options & DEBUG) && !replay) tsp->trace ? trace_path(tsp->trace, cur, false) : path_print(cur);
+  /* try to extend the current path with all cities (from the resumed one, if any) */
+  for (uint city = search_resume(tsp, cur); city < tsp->size && !tsp->search.stopped; city++) {
+    KERNEL(path_push)(tsp, cur, aggs, city);
+    if (KERNEL(path_check)(tsp, cur, sol)) {
+      if (cur->curlen == tsp->size) {
+#if OBJ_CLOSED
+        KERNEL(path_push)(tsp, cur, aggs, tsp->first); /* come back to the first city */
+#endif
+        if (cur->dist < sol->dist) {
+          path_copy(cur, sol);
+          if (tsp->profile) profile_record(tsp->profile, sol->dist);
+        }
+        if (tsp->options & VERBOSE) tsp->trace ? trace_path(tsp->trace, cur, true) : path_print(cur);
+        if (count) (*count)++;
+#if OBJ_CLOSED
+        KERNEL(path_pop)(tsp, cur, aggs);
+#endif
+      }
+      KERNEL(tsp_solve_rec)(tsp, cur, aggs, sol, count);
+    }
+    KERNEL(path_pop)(tsp, cur, aggs);
+  }
+}
+
+/* ************************************************************************** */
+
+/* random probe from cur down to a leaf, through the children passing the real checks (Knuth): return
+ * the estimated nb of search nodes below cur, and add the estimated nb of complete paths to leaves */
+static double KERNEL(search_probe)(TSP *tsp, path *cur, uint *aggs, path *sol, uint *children,
+                                   unsigned long long *state, double *leaves) {
+  uint len = cur->curlen;
+  double nodes = 0.0, weight = 1.0;
+  while (cur->curlen < tsp->size) {
+    nodes += weight;
+    uint k = 0;
+    for (uint city = 0; city < tsp->size; city++) {
+      KERNEL(path_push)(tsp, cur, aggs, city);
+      if (KERNEL(path_check)(tsp, cur, sol)) children[k++] = city;
+      KERNEL(path_pop)(tsp, cur, aggs);
+    }
+    if (k == 0) break;
+    weight *= k;
+    KERNEL(path_push)(tsp, cur, aggs, children[rng_next(state) % k]);
+  }
+  if (cur->curlen == tsp->size) *leaves += weight;
+  while (cur->curlen > len) KERNEL(path_pop)(tsp, cur, aggs);
+  return nodes;
+}
+
+/* ************************************************************************** */
+
+#undef KERNEL
+#undef KERNEL_CAT
+#undef KERNEL_CAT2
+#undef OBJ_NAME
+#undef OBJ_AGG
+#undef OBJ_INVERTIBLE
+#undef OBJ_BOUND
+#undef OBJ_CLOSED
@@ -0,0 +1,249 @@
+/**
+ * @file tsp_private.h
+ * @brief Private types and helpers shared by the TSP library modules.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#ifndef TSP_PRIVATE_H
+#define TSP_PRIVATE_H
+
+#include <math.h>
+#include <time.h>
+
+#include "tsp.h"
+
+/* ************************************************************************** */
+/*                                TYPES                                       */
+/* ************************************************************************** */
+
+/* state of the exact search, for checkpoint and resume */
+typedef struct search {
+  unsigned long long nodes; /* nb of search nodes explored */
+  unsigned long long limit; /* max nb of nodes, then stop after a checkpoint (or 0) */
+  char *checkpoint;         /* checkpoint file (or NULL) */
+  uint period;              /* min nb of seconds between two checkpoints */
+  time_t last;              /* time of the last checkpoint */
+  bool stopped;             /* search stopped at node limit */
+  bool done;                /* search already completed before resuming */
+  uint *resume;             /* path to resume from, visited again from scratch (or NULL) */
+  uint resumelen;           /* length of the path to resume from */
+  struct path *incumbent;   /* best tour found before resuming (or NULL) */
+  uint count;               /* nb of complete paths explored before resuming */
+} search;
+
+/* memo cache of a distance callback, split into shards of their own lock and hash table: writers take the
+ * lock, readers do not */
+#define MEMO_BITS 6 /* log2 of the nb of shards */
+#define MEMO_SHARDS (1 << MEMO_BITS)
+
+typedef struct memo_table {
+  unsigned long long *keys; /* pair (i,j) as i*2^32+j+1, or 0 for an empty slot (linear probing) */
+  uint *vals;               /* distance of each pair, written before its key */
+  uint cap;                 /* nb of slots (power of 2) */
+  struct memo_table *old;   /* previous table, replaced when full but kept for readers until memo_free */
+} memo_table;
+
+typedef struct shard {
+  memo_table *table; /* current hash table */
+  uint len;          /* nb of pairs */
+  char lock;         /* spinlock of writers */
+} __attribute__((aligned(64))) shard;
+
+typedef struct memo {
+  distfn fn;                 /* distance callback */
+  void *data;                /* user data of the callback */
+  bool symmetric;            /* pairs (i,j) and (j,i) share one entry */
+  unsigned long long calls;  /* nb of callback calls */
+  double *hint;              /* approximate coordinates of the cities, to preselect candidates (or NULL) */
+  uint *knn[2];              /* k nearest successors and predecessors of each city, once computed (or NULL) */
+  uint knnk[2];              /* nb of neighbours per city in knn */
+  char lock;                 /* spinlock on knn */
+  shard shards[MEMO_SHARDS]; /* hash table shards, selected by the high bits of the pair hash */
+} memo;
+
+/* ************************************************************************** */
+
+typedef struct TSP {
+  uint size;             /* nb of cities (problem size)) */
+  uint first;            /* first city */
+  uint *distmat;         /* distance matrix (or NULL) */
+  bool missing;          /* some arcs of the distance matrix are missing (DIST_INF), never used by tours */
+  double *points;        /* city coordinates (or NULL) */
+  memo *memo;            /* distance callback and its memo cache (or NULL) */
+  struct TSP *asym;      /* asymmetric instance transformed into this symmetric one (or NULL) */
+  uint ghost;            /* transformation: extra cost of arcs, so that ghost edges are always used */
+  uint forbidden;        /* transformation: cost of edges between two in-nodes or two out-nodes */
+  unsigned char options; /* options: verbose, debug, optimize, ... */
+  search search;         /* exact search state */
+  elite *elite;          /* elite pool shared by engines (or NULL) */
+  struct cand *cand;     /* candidate lists shared by engines, instead of their own (or NULL) */
+  trace *trace;          /* binary trace of the exact search, instead of debug and verbose prints (or NULL) */
+  profile *profile;      /* anytime profile of the incumbents of all engines (or NULL) */
+} TSP;
+
+/* ************************************************************************** */
+
+typedef struct path {
+  uint *array; /* array of cities in path */
+  uint curlen; /* current length of path */
+  uint maxlen; /* max length of path */
+  uint dist;   /* current distance of path */
+} path;
+
+/* ************************************************************************** */
+
+typedef struct cand {
+  uint size;   /* nb of cities */
+  uint *start; /* neighbours of city i are adj[start[i]] ... adj[start[i+1]-1] */
+  uint *adj;   /* neighbour lists, sorted by increasing distance */
+} cand;
+
+/* ************************************************************************** */
+
+typedef struct elite {
+  TSP *tsp;
+  uint capacity;            /* max nb of tours */
+  uint len;                 /* current nb of tours */
+  path **tours;             /* tours sorted by increasing distance */
+  unsigned long long *hash; /* hash of each tour, same for all its rotations and reflections */
+  uint worst;               /* distance of the worst tour if full (or UINT_MAX), read without lock */
+  char lock;                /* spinlock */
+} elite;
+
+/* ************************************************************************** */
+
+typedef struct kdnode {
+  uint lo, hi; /* cities perm[lo] ... perm[hi-1] */
+  uint dim;    /* split dimension (0 for x, 1 for y) */
+  double cut;  /* split coordinate */
+  int left;    /* left child (or -1 for a leaf) */
+  int right;   /* right child (or -1 for a leaf) */
+} kdnode;
+
+typedef struct kdtree {
+  uint size;      /* nb of cities */
+  double *points; /* city coordinates */
+  uint *perm;     /* cities sorted by tree leaves */
+  kdnode *nodes;  /* tree nodes, root first */
+  uint nnodes;    /* nb of nodes */
+} kdtree;
+
+/* ************************************************************************** */
+/*                              DISTANCE                                      */
+/* ************************************************************************** */
+
+/* rounded euclidean distance, as in TSPLIB EUC_2D */
+static inline uint points_dist(double *points, uint i, uint j) {
+  double dx = points[2 * i] - points[2 * j];
+  double dy = points[2 * i + 1] - points[2 * j + 1];
+  return (uint)(sqrt(dx * dx + dy * dy) + 0.5);
+}
+
+static inline uint tsp_dist(TSP *tsp, uint i, uint j);
+
+/* distance of a callback instance, from the memo cache or fetched and memoized on a miss */
+uint memo_dist(memo *m, uint i, uint j);
+
+/* symmetric transformation of an asymmetric instance: city i is split into in-node i and out-node
+ * i+n, and arc (i,j) becomes edge (i+n,j), forbidden if the arc is missing */
+static inline uint sym_dist(TSP *tsp, uint i, uint j) {
+  uint n = tsp->asym->size;
+  if (i == j) return 0;
+  if (i + n == j || j + n == i) return 0; /* ghost edge */
+  if ((i < n) == (j < n)) return tsp->forbidden;
+  uint d = (i >= n) ? tsp_dist(tsp->asym, i - n, j) : tsp_dist(tsp->asym, j - n, i);
+  return (d == DIST_INF) ? tsp->forbidden : d + tsp->ghost;
+}
+
+static inline uint tsp_dist(TSP *tsp, uint i, uint j) {
+  if (tsp->distmat) return tsp->distmat[i * tsp->size + j];
+  if (tsp->points) return points_dist(tsp->points, i, j);
+  if (tsp->memo) return memo_dist(tsp->memo, i, j);
+  return sym_dist(tsp, i, j);
+}
+
+/* xorshift random generator, reproducible and thread-safe with one state per task */
+static inline uint rng_next(unsigned long long *state) {
+  unsigned long long x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return (uint)(x >> 32);
+}
+
+/* ************************************************************************** */
+/*                              INTERNALS                                     */
+/* ************************************************************************** */
+
+/* exit with an error message on an unreadable, truncated or malformed file */
+void file_fail(char *filename, char *reason);
+
+/* copy a path into another one of the same max length */
+void path_copy(path *src, path *dst);
+
+/* build a tour path (starting from first city) from a cycle of n cities */
+path *path_from_cycle(TSP *tsp, uint *cycle, uint n);
+
+/* rotate a tour (whose n first cities form a cycle) to start from first city, and update its distance */
+void path_rotate(TSP *tsp, path *p);
+
+/* exact search of all complete paths extending cur (starting from first city), for the objective of tsp */
+void search_run(TSP *tsp, path *cur, path *sol, uint *count);
+
+/* random probe of the exact search below cur, with the bound of sol: return the estimated nb of nodes,
+ * and add the estimated nb of complete paths to leaves (children: buffer of size cities) */
+double search_probe(TSP *tsp, path *cur, path *sol, uint *children, unsigned long long *state, double *leaves);
+
+/* record a node (or a complete path) of the exact search in the buffer of the calling thread */
+void trace_path(trace *tr, path *p, bool solution);
+
+/* memo cache of a distance callback, with optional pairs (i,j) and (j,i) merged */
+memo *memo_new(distfn fn, void *data, bool symmetric);
+void memo_free(memo *m);
+
+/* call the distance callback, without memo cache */
+uint memo_call(memo *m, uint i, uint j);
+
+/* memoize the distance of a pair, unless already there */
+void memo_put(memo *m, uint i, uint j, uint d);
+
+/* get the k nearest successor (or predecessor) lists of all n cities, if already computed with at least k */
+bool memo_knn_get(memo *m, uint n, uint k, bool in, uint *adj);
+
+/* keep the k nearest successor (or predecessor) lists of all n cities, to avoid fetching them again */
+void memo_knn_set(memo *m, uint n, uint k, bool in, uint *adj);
+
+/* kd-tree with leaves of at most bucket cities */
+kdtree *kdtree_new(uint size, double *points, uint bucket);
+void kdtree_free(kdtree *kd);
+
+/* k nearest neighbours of a city, sorted by increasing distance */
+void kdtree_knn(kdtree *kd, uint city, uint k, uint *nbr);
+
+/* k nearest predecessors of each city (the same as cand_knn for symmetric distances) */
+cand *cand_knn_in(TSP *tsp, uint k);
+
+/* reverse a cycle of n cities between positions i and j (included), or the complementary part if shorter */
+void ls_reverse(uint *cycle, uint *pos, uint n, uint i, uint j);
+
+/* 2-opt on a cycle of all cities, starting with the given active cities (or all if queue is NULL) */
+void ls_2opt(TSP *tsp, cand *c, uint *cycle, uint *queue, uint qlen);
+
+/* optimize a sub-path with fixed ends (exactly if small enough), and return the gain */
+long long ls_path(TSP *tsp, uint *cities, uint len);
+
+/* buffer of at least a huge page aligned and advised for transparent huge pages (unless HUGE_OFF), and
+ * zeroed if required: freed by free() */
+void *huge_alloc(size_t bytes, bool zero);
+
+/* zeroed buffer on explicit huge pages in HUGE_EXPLICIT mode, else as huge_alloc: freed by huge_free, which
+ * searches the live explicit mappings, so only for a few large and long-lived buffers (not tours) */
+void *huge_map(size_t bytes);
+void huge_free(void *ptr);
+
+/* ************************************************************************** */
+
+#endif
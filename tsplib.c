@@ -0,0 +1,103 @@
+/**
+ * @file tsplib.c
+ * @brief Loader of TSPLIB files: city coordinates (EUC_2D) or explicit distance matrices.
+ * @author aurelien.esnard@u-bordeaux.fr
+ * @copyright University of Bordeaux. All rights reserved, 2023.
+ *
+ **/
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tsp_private.h"
+
+#define TSPLIB_LINE 256 /* max length of a header line */
+
+/* ************************************************************************** */
+
+/* split a header line "KEY : VALUE" (spaces around the colon are optional), or a section name without value */
+static bool tsplib_header(char *line, char **key, char **value) {
+  line[strcspn(line, "\r\n")] = '\0';
+  char *colon = strchr(line, ':');
+  *value = "";
+  if (colon) {
+    *colon = '\0';
+    *value = colon + 1;
+    while (**value == ' ' || **value == '\t') (*value)++;
+    char *end = *value + strlen(*value);
+    while (end > *value && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+  }
+  *key = line;
+  while (**key == ' ' || **key == '\t') (*key)++;
+  char *end = *key + strlen(*key);
+  while (end > *key && (end[-1] == ' ' || end[-1] == '\t')) *--end = '\0';
+  return **key != '\0';
+}
+
+/* ************************************************************************** */
+
+/* weights of an explicit section, in one of the full or triangular formats, into a full matrix */
+static void tsplib_weights(FILE *file, char *filename, char *format, uint size, uint *distmat) {
+  bool full = (strcmp(format, "FULL_MATRIX") == 0);
+  bool upper = (strncmp(format, "UPPER_", 6) == 0);
+  bool diag = (strstr(format, "DIAG") != NULL);
+  if (!full && !upper && strncmp(format, "LOWER_", 6) != 0) file_fail(filename, "unsupported TSPLIB weight format");
+  for (uint i = 0; i < size; i++) {
+    uint lo = 0, hi = size; /* columns of row i */
+    if (upper) lo = diag ? i : i + 1;
+    else if (!full) hi = diag ? i + 1 : i;
+    for (uint j = lo; j < hi; j++) {
+      uint d;
+      if (fscanf(file, "%u", &d) != 1) file_fail(filename, "truncated TSPLIB weights");
+      distmat[i * size + j] = d;
+      if (!full) distmat[j * size + i] = d;
+    }
+  }
+  for (uint i = 0; i < size; i++) distmat[i * size + i] = 0;
+}
+
+/* ************************************************************************** */
+
+void tsplib_load(char *filename, uint *size, uint **distmat, double **points) {
+  assert(filename && size && distmat && points);
+  FILE *file = fopen(filename, "r");
+  if (!file) file_fail(filename, "cannot read TSPLIB file");
+  char line[TSPLIB_LINE];
+  char type[TSPLIB_LINE] = "", format[TSPLIB_LINE] = "FULL_MATRIX";
+  *size = 0;
+  *distmat = NULL;
+  *points = NULL;
+  while (fgets(line, TSPLIB_LINE, file)) {
+    char *key, *value;
+    if (!tsplib_header(line, &key, &value)) continue;
+    if (strcmp(key, "EOF") == 0) break;
+    else if (strcmp(key, "DIMENSION") == 0) *size = (uint)strtoul(value, NULL, 10);
+    else if (strcmp(key, "EDGE_WEIGHT_TYPE") == 0) strcpy(type, value);
+    else if (strcmp(key, "EDGE_WEIGHT_FORMAT") == 0) strcpy(format, value);
+    else if (strcmp(key, "NODE_COORD_SECTION") == 0) {
+      if (*size == 0 || strcmp(type, "EUC_2D") != 0) /* rounded euclidean distances, as tsp_new_points */
+        file_fail(filename, "unsupported TSPLIB coordinates");
+      *points = malloc(2 * *size * sizeof(double));
+      assert(*points);
+      for (uint i = 0; i < *size; i++) {
+        uint id;
+        double x, y;
+        if (fscanf(file, "%u %lf %lf", &id, &x, &y) != 3 || id < 1 || id > *size) /* cities numbered from 1 */
+          file_fail(filename, "truncated or malformed TSPLIB coordinates");
+        (*points)[2 * (id - 1)] = x;
+        (*points)[2 * (id - 1) + 1] = y;
+      }
+    } else if (strcmp(key, "EDGE_WEIGHT_SECTION") == 0) {
+      if (*size == 0 || strcmp(type, "EXPLICIT") != 0) file_fail(filename, "unsupported TSPLIB weights");
+      *distmat = huge_alloc((size_t)*size * *size * sizeof(uint), false);
+      tsplib_weights(file, filename, format, *size, *distmat);
+    }
+  }
+  fclose(file);
+  if (!*distmat && !*points) file_fail(filename, "no coordinates nor weights in TSPLIB file");
+}
+
+/* ************************************************************************** */